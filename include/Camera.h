@@ -0,0 +1,17 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Game_Config.h"
+
+// World-space rectangle currently shown in the window.
+typedef struct Camera {
+    SDL_Rect view;
+} Camera;
+
+void camera_init(Camera *camera, int w, int h);
+void camera_follow(Camera *camera, const SDL_Rect *target);
+bool camera_is_visible(const Camera *camera, const SDL_Rect *rect);
+SDL_Rect camera_to_screen(const Camera *camera, const SDL_Rect *rect);
+
+#endif
@@ -4,14 +4,27 @@
 #define WINDOW_WIDTH 1000
 #define WINDOW_HEIGHT 600
 
+#define MAX_PLAYERS 64 // Default size of a match, the dedicated server can be started with more
+
+#define TICK_RATE 60          // Default simulation rate in Hz, independent from the frame rate
+#define TICK_RATE_MIN 10      // Range accepted for --tick-rate
+#define TICK_RATE_MAX 240
+#define MAX_FRAME_RATE 240    // Rendering cap for when vsync is unavailable
+#define MAX_FRAME_SECONDS 0.25
+#define PLAYER_SPEED 300.0f   // Pixels per second
+
 #define MAP_WIDTH 50
 #define MAP_HEIGHT 50
 #define TILE_SIZE 16
+#define TILE_RENDER_SIZE (TILE_SIZE * 2)
+#define TERRAIN_CHUNK_TILES 16
+#define MAP_PIXEL_WIDTH (MAP_WIDTH * TILE_RENDER_SIZE)
+#define MAP_PIXEL_HEIGHT (MAP_HEIGHT * TILE_RENDER_SIZE)
 
 typedef struct {
-    int id;
-    int x, y;
-    SDL_Texture *texture;
+    int id; // Slot index and generation, see Player_Table.h
+    float x, y;
+    float prev_x, prev_y; // Position at the previous tick, for interpolation
     SDL_Rect rect;
     bool active;
 } Player;
@@ -0,0 +1,47 @@
+#ifndef INTERPOLATION_H
+#define INTERPOLATION_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Game_Config.h"
+
+// Remote players are shown a little in the past, between two snapshots that already arrived,
+// instead of jumping to each one as it comes in.
+#define INTERPOLATION_SAMPLES 16              // Per player, power of two; must span the delay
+#define INTERPOLATION_DELAY_MS 100            // Default, covers a lost snapshot or two at 60 Hz
+#define INTERPOLATION_MAX_EXTRAPOLATION_MS 200 // How far a player is carried past its newest sample
+#define INTERPOLATION_RESYNC_TICKS 30.0       // Clock errors beyond this are jumped, smaller ones eased
+#define INTERPOLATION_MAX_GAP_TICKS 60        // Samples further apart are not blended
+
+typedef struct InterpolationSample {
+    Uint32 tick; // Server tick of the snapshot
+    float x, y;
+} InterpolationSample;
+
+// Recent positions of one player, oldest to newest in a ring
+typedef struct InterpolationTrack {
+    int id; // Player the samples belong to, a new ID in the slot starts over
+    int count;
+    int newest;
+    InterpolationSample samples[INTERPOLATION_SAMPLES];
+} InterpolationTrack;
+
+typedef struct Interpolation {
+    InterpolationTrack *tracks; // By player slot
+    int capacity;
+    float delay;             // Ticks
+    float max_extrapolation; // Ticks
+    double render_tick;      // Server time being shown
+    Uint32 latest_tick;      // Newest snapshot received
+    double since_latest;     // Local ticks since it arrived
+    bool started;
+} Interpolation;
+
+bool interpolation_init(Interpolation *interpolation, int capacity, float delay, float max_extrapolation);
+void interpolation_destroy(Interpolation *interpolation);
+void interpolation_receive(Interpolation *interpolation, Uint32 tick);
+void interpolation_remove(Interpolation *interpolation, int id);
+void interpolation_push(Interpolation *interpolation, int id, Uint32 tick, float x, float y);
+void interpolation_advance(Interpolation *interpolation, float ticks);
+bool interpolation_sample(const Interpolation *interpolation, int id, float alpha, float *x, float *y);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef NET_BITS_H
+#define NET_BITS_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+
+// Packs fields of any width up to 32 bits into bytes, least significant bit first, so values
+// take only the bits their range needs. Running past the end sets overflow instead of touching
+// memory out of bounds, it is checked once after the last field.
+typedef struct NetBitWriter {
+    Uint8 *buffer;
+    int capacity; // Bytes
+    int bits;     // Written so far
+    bool overflow;
+} NetBitWriter;
+
+typedef struct NetBitReader {
+    const Uint8 *buffer;
+    int length; // Bytes
+    int bits;   // Read so far
+    bool overflow;
+} NetBitReader;
+
+void net_bit_writer_init(NetBitWriter *writer, Uint8 *buffer, int capacity);
+void net_bits_write(NetBitWriter *writer, Uint32 value, int bits);
+void net_bits_write_signed(NetBitWriter *writer, Sint32 value, int bits);
+int net_bit_writer_bytes(const NetBitWriter *writer);
+
+void net_bit_reader_init(NetBitReader *reader, const Uint8 *buffer, int length);
+Uint32 net_bits_read(NetBitReader *reader, int bits);
+Sint32 net_bits_read_signed(NetBitReader *reader, int bits);
+int net_bit_reader_bytes(const NetBitReader *reader);
+
+bool net_bits_fit_signed(Sint32 value, int bits);
+Uint32 net_quantize(Sint32 value, int bits);
+
+#endif
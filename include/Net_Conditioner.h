@@ -0,0 +1,30 @@
+#ifndef NET_CONDITIONER_H
+#define NET_CONDITIONER_H
+#include "../SDL2/include/SDL.h"
+#include "../SDL2/include/SDL_net.h"
+#include <stdbool.h>
+#include "Net_Protocol.h"
+
+// Optional bad-network simulation for local testing. Datagrams in both directions are delayed,
+// lost, duplicated or reordered on their way through this process, so conditioning one side
+// of a localhost session is enough. The stream is left alone, it only carries the join and
+// reliable events. Off unless one of the options is given.
+#define NET_CONDITIONER_CAPACITY 512 // Datagrams held back at once, further ones are lost
+#define NET_CONDITIONER_REORDER_MS 50 // Extra delay of a datagram picked to arrive out of order
+
+typedef struct NetConditions {
+    int latency_ms;  // Added to each direction
+    int jitter_ms;   // Up to this much more, at random
+    float loss;      // Chances from 0 to 1
+    float duplicate;
+    float reorder;
+} NetConditions;
+
+bool net_conditions_parse(NetConditions *conditions, int argc, char *argv[], int *i);
+void net_conditioner_configure(const NetConditions *conditions);
+bool net_conditioner_enabled(void);
+int net_conditioner_send(UDPsocket socket, UDPpacket *packet);
+int net_conditioner_receive(UDPsocket socket, UDPpacket *packet);
+void net_conditioner_flush(void);
+
+#endif
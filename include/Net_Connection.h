@@ -0,0 +1,81 @@
+#ifndef NET_CONNECTION_H
+#define NET_CONNECTION_H
+#include "../SDL2/include/SDL.h"
+#include "../SDL2/include/SDL_net.h"
+#include <stdbool.h>
+#include "Net_Protocol.h"
+
+// Must be a power of two and hold several NET_MAX_MESSAGE_SIZE frames.
+#define NET_RING_BUFFER_SIZE 8192
+
+// Stream sends are queued and flushed without blocking. A peer that reads too slowly first
+// misses per-tick state, which the next tick replaces anyway; if even reliable messages no
+// longer fit, or nothing goes out for NET_SEND_STALL_MS, it is disconnected.
+#define NET_SEND_STATE_LIMIT (NET_RING_BUFFER_SIZE / 4)
+#define NET_SEND_STALL_MS 5000
+
+// Byte ring buffer; head and tail run freely and are masked on access.
+typedef struct NetRingBuffer {
+    Uint8 data[NET_RING_BUFFER_SIZE];
+    Uint32 head;
+    Uint32 tail;
+} NetRingBuffer;
+
+void net_ring_buffer_clear(NetRingBuffer *ring);
+int net_ring_buffer_used(const NetRingBuffer *ring);
+int net_ring_buffer_free(const NetRingBuffer *ring);
+int net_ring_buffer_write(NetRingBuffer *ring, const void *data, int length);
+void net_ring_buffer_peek(const NetRingBuffer *ring, void *data, int length);
+void net_ring_buffer_consume(NetRingBuffer *ring, int length);
+
+// Traffic of one connection, counted as it happens on both channels. The rates, queue depth
+// and round trip time are filled in by the owner of the connection, see Network.h.
+typedef struct NetStats {
+    Uint64 bytes_in;
+    Uint64 bytes_out;
+    Uint32 messages_in;
+    Uint32 messages_out;
+    Uint32 drops;    // Messages lost on our side: stale datagrams, skipped state, full queues
+    int send_queue;  // Bytes waiting in the send buffer
+    float rtt_ms;    // Smoothed, negative before the first measurement
+    float kbps_in;   // Kilobits per second
+    float kbps_out;
+    float messages_in_rate; // Per second
+    float messages_out_rate;
+} NetStats;
+
+typedef struct NetConnection {
+    TCPsocket socket;
+    NetRingBuffer receive_buffer;
+    NetRingBuffer send_buffer;
+    Uint32 send_progress_ticks; // Last time the send buffer was empty or drained some
+    Uint32 send_sequence;
+    bool closed;
+    // Unreliable channel for per-tick state, usable once the peer's datagram address is known
+    IPaddress udp_address;
+    Uint32 udp_token;
+    Uint32 udp_sequence;
+    bool udp_bound;
+    NetStats stats;
+} NetConnection;
+
+// Returns false to leave the message in the receive buffer and stop dispatching for now.
+typedef bool (*NetMessageHandler)(NetConnection *connection, const NetMessage *message);
+
+void net_connection_init(NetConnection *connection, TCPsocket socket);
+void net_connection_close(NetConnection *connection);
+int net_connection_receive(NetConnection *connection, SDLNet_SocketSet socket_set);
+int net_connection_receive_all(NetConnection *connection, bool *drained);
+int net_connection_dispatch(NetConnection *connection, NetMessageHandler handler);
+bool net_connection_send(NetConnection *connection, Uint8 *data, int length);
+int net_connection_flush(NetConnection *connection);
+int net_connection_pending(const NetConnection *connection);
+bool net_connection_send_datagram(NetConnection *connection, UDPsocket socket, Uint8 *data, int length);
+bool net_connection_accept_datagram(NetConnection *connection, const UDPpacket *packet, const NetHeader *header);
+Uint32 net_connection_new_token(void);
+void net_connection_measure_rtt(NetConnection *connection, Uint32 ping);
+#ifndef _WIN32
+int net_socket_fd(const void *socket); // OS descriptor behind an SDL_net socket
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef NET_POLLER_H
+#define NET_POLLER_H
+#include "../SDL2/include/SDL.h"
+#include "../SDL2/include/SDL_net.h"
+#include <stdbool.h>
+
+// Waits for sockets to become readable. On Linux this is epoll, edge-triggered, so the cost of
+// a wait does not grow with the number of idle connections; elsewhere (or when built with
+// NET_NO_EPOLL) an SDL_net socket set. Either way a socket is only reported once per batch of
+// new data, the caller keeps reading it until it would block.
+#if defined(__linux__) && !defined(NET_NO_EPOLL)
+#define NET_USE_EPOLL
+#endif
+
+#define NET_POLL_EVENTS 256 // Reported per wait, the rest come with the next one
+
+// Keys identify sockets in what a wait reports; connections use their slot index.
+#define NET_POLL_LISTEN -1
+#define NET_POLL_DATAGRAM -2
+
+typedef struct NetPoller {
+#ifdef NET_USE_EPOLL
+    int epoll_fd;
+#else
+    SDLNet_SocketSet set;
+    void **sockets; // By key + 2, to test each one after a wait
+#endif
+    int capacity;
+} NetPoller;
+
+bool net_poller_init(NetPoller *poller, int capacity);
+void net_poller_destroy(NetPoller *poller);
+bool net_poller_add_tcp(NetPoller *poller, TCPsocket socket, int key);
+bool net_poller_add_udp(NetPoller *poller, UDPsocket socket, int key);
+void net_poller_remove_tcp(NetPoller *poller, TCPsocket socket, int key);
+int net_poller_wait(NetPoller *poller, int timeout_ms, int *keys, int max_keys);
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef NET_PROTOCOL_H
+#define NET_PROTOCOL_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Game_Config.h"
+
+#define NET_PROTOCOL_VERSION 9
+#define NET_HEADER_SIZE 8
+#define NET_MAX_PAYLOAD 1024
+#define NET_MAX_MESSAGE_SIZE (NET_HEADER_SIZE + NET_MAX_PAYLOAD)
+#define NET_BINDING_SIZE 12
+#define NET_ACK_SIZE 4
+#define NET_PING_SIZE 4
+#define NET_LEAVE_SIZE 2
+#define NET_MAX_INPUTS 16 // Unacknowledged inputs resent with every new one, so a lost datagram costs nothing
+
+// Entity state is bit-packed (see Net_Bits.h): positions are whole pixels on the map, which
+// takes NET_POSITION_BITS per axis, inputs take their four buttons. IDs keep all 16 bits.
+#define NET_POSITION_BITS 11
+#define NET_PLAYER_STATE_BITS (16 + 2 * NET_POSITION_BITS)
+#define NET_INPUT_BITS 4
+#define NET_DELTA_SMALL_BITS 6 // Position changes of a few ticks of movement
+#define NET_DELTA_BITS (NET_POSITION_BITS + 1) // Any other change within the map
+#define NET_MAX_WORLD_PLAYERS ((NET_MAX_PAYLOAD * 8 - 8) / NET_PLAYER_STATE_BITS)
+#define NET_ENTRY_COUNT_BITS 8
+#define NET_FAR_COUNT_BITS 6
+
+// Everything in a snapshot but its players, at worst: tick, a full baseline, input ack, own
+// position and both counts. The overhead adds the message header and the padding to a byte.
+#define NET_SNAPSHOT_HEADER_BITS (32 + 1 + 32 + 32 + 2 * NET_POSITION_BITS + NET_ENTRY_COUNT_BITS + NET_FAR_COUNT_BITS)
+#define NET_SNAPSHOT_OVERHEAD_BITS (NET_HEADER_SIZE * 8 + NET_SNAPSHOT_HEADER_BITS + 7)
+
+// A snapshot describes the client's frame, the players in its view, as changes against a
+// frame the client acknowledged. Both limits keep the worst case inside one payload.
+#define NET_MAX_FRAME_PLAYERS 64
+#define NET_MAX_DELTA_ENTRIES (NET_MAX_FRAME_PLAYERS * 2) // Every player left and as many came in
+#define NET_MAX_FAR_PLAYERS 48
+#define NET_NO_BASELINE 0xFFFFFFFF
+
+#define NET_DELTA_REMOVED 0x01 // Left the frame
+#define NET_DELTA_ADDED 0x02   // New to the frame, x and y are absolute
+#define NET_DELTA_X 0x04       // x changed by the given amount
+#define NET_DELTA_Y 0x08
+
+// Wire layout (little-endian): version u8, type u8, payload length u16, sequence u32, payload.
+typedef enum NetMessageType {
+    NET_MSG_ID = 1,
+    NET_MSG_INPUT,
+    NET_MSG_SYNC,
+    NET_MSG_WORLD,
+    NET_MSG_BIND,
+    NET_MSG_SNAPSHOT,
+    NET_MSG_ACK,
+    NET_MSG_PING, // Answered by the peer's network thread with a PONG, for round trip times
+    NET_MSG_PONG,
+    NET_MSG_LEAVE // A player left the match, sent to everyone still in it
+} NetMessageType;
+
+typedef struct NetHeader {
+    Uint8 version;
+    Uint8 type;
+    Uint16 length;
+    Uint32 sequence;
+} NetHeader;
+
+// Sent with the ID over TCP, echoed back over UDP so the server can tie a datagram address to a player.
+typedef struct NetBinding {
+    Uint16 id;
+    Uint32 token;
+    Uint16 tick_rate; // Clients simulate at the server's rate so their prediction matches
+    Uint32 connection; // Server's handle for the client's connection, the bind goes straight to it
+} NetBinding;
+
+// The newest input commands of a client, oldest first, the last one has the given sequence.
+typedef struct NetInput {
+    Uint8 count;
+    Uint32 sequence;
+    Uint8 inputs[NET_MAX_INPUTS];
+} NetInput;
+
+// Player IDs carry their slot generation, see Player_Table.h
+typedef struct NetPlayerState {
+    Uint16 id;
+    Sint16 x, y;
+} NetPlayerState;
+
+// Every active player, sent once to a joining client.
+typedef struct NetWorldState {
+    Uint8 count;
+    NetPlayerState players[NET_MAX_WORLD_PLAYERS];
+} NetWorldState;
+
+typedef struct NetDeltaEntry {
+    Uint16 id;
+    Uint8 flags;
+    Sint16 x, y; // Absolute when added, otherwise the change from the baseline
+} NetDeltaEntry;
+
+// One server tick for one client. Entries are sorted by ID. Far players are outside the
+// frame and sent in full now and then.
+typedef struct NetSnapshot {
+    Uint32 tick;
+    Uint32 baseline; // Tick of the frame the entries apply to, NET_NO_BASELINE for none
+    Uint32 input_ack; // Last input of the receiving client the server has simulated,
+    Sint16 self_x;    // and where that left the client's own player
+    Sint16 self_y;
+    Uint8 count;
+    Uint8 far_count;
+    NetDeltaEntry entries[NET_MAX_DELTA_ENTRIES];
+    NetPlayerState far[NET_MAX_FAR_PLAYERS];
+} NetSnapshot;
+
+typedef struct NetMessage {
+    NetHeader header;
+    union {
+        NetBinding binding;
+        NetInput input;
+        NetPlayerState player;
+        NetWorldState world;
+        NetSnapshot snapshot;
+        Uint32 ack; // Newest snapshot tick the client has
+        Uint32 ping; // Sender's clock in milliseconds, echoed back unchanged in the pong
+        Uint16 leave; // ID of the player that left
+    } data;
+} NetMessage;
+
+void net_write_u16(Uint8 *buffer, Uint16 value);
+void net_write_u32(Uint8 *buffer, Uint32 value);
+Uint16 net_read_u16(const Uint8 *buffer);
+Uint32 net_read_u32(const Uint8 *buffer);
+
+void net_stamp_sequence(Uint8 *buffer, Uint32 sequence);
+bool net_decode_header(const Uint8 *buffer, int length, NetHeader *header);
+int net_encode_message(const NetMessage *message, Uint8 *buffer, int capacity);
+int net_encode(NetMessageType type, NetMessage *message, Uint8 *buffer);
+void net_player_state(NetPlayerState *state, const Player *player);
+int net_decode_message(const Uint8 *buffer, int length, NetMessage *message);
+int net_snapshot_entry_bits(const NetPlayerState *from, const NetPlayerState *to);
+
+#endif
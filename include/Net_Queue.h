@@ -0,0 +1,25 @@
+#ifndef NET_QUEUE_H
+#define NET_QUEUE_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+
+// Single-producer/single-consumer ring of fixed-size elements, lock-free between two threads.
+// The producer fills a slot in place between begin_push and end_push, the consumer reads it in
+// place between peek and pop, so elements are never copied through the queue.
+typedef struct NetQueue {
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    int capacity;
+    int element_size;
+    Uint8 *elements;
+} NetQueue;
+
+bool net_queue_init(NetQueue *queue, int capacity, int element_size);
+void net_queue_destroy(NetQueue *queue);
+void *net_queue_begin_push(NetQueue *queue);
+void net_queue_end_push(NetQueue *queue);
+void *net_queue_peek(NetQueue *queue);
+void net_queue_pop(NetQueue *queue);
+bool net_queue_full(NetQueue *queue);
+
+#endif
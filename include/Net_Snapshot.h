@@ -0,0 +1,26 @@
+#ifndef NET_SNAPSHOT_H
+#define NET_SNAPSHOT_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Net_Protocol.h"
+
+// Both ends keep the frames of the last NET_FRAME_HISTORY ticks, indexed by tick, so a
+// snapshot can name any of them as its baseline. Must be a power of two.
+#define NET_FRAME_HISTORY 32
+#define NET_FRAME_SLOT(tick) ((tick) & (NET_FRAME_HISTORY - 1))
+
+// The full state of one client's view at one tick, sorted by player ID.
+typedef struct NetFrame {
+    Uint32 tick;
+    int count;
+    NetPlayerState players[NET_MAX_FRAME_PLAYERS];
+} NetFrame;
+
+void net_frame_history_clear(NetFrame *frames);
+const NetFrame *net_frame_history_find(const NetFrame *frames, Uint32 tick);
+void net_frame_sort(NetFrame *frame);
+const NetPlayerState *net_frame_find(const NetFrame *frame, Uint16 id);
+void net_snapshot_diff(const NetFrame *baseline, const NetFrame *frame, NetSnapshot *snapshot);
+bool net_snapshot_apply(const NetFrame *baseline, const NetSnapshot *snapshot, NetFrame *frame);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+#include "../SDL2/include/SDL.h"
+#include "../SDL2/include/SDL_net.h"
+#include <stdbool.h>
+#include "Game_Config.h"
+#include "Net_Protocol.h"
+#include "Net_Connection.h"
+
+// Sockets live on a dedicated I/O thread; the game loop only exchanges events and send
+// commands with it through lock-free queues, so a slow peer never stalls a frame. The thread
+// only visits connections with something to do, see Net_Poller.h, or whose timer for a ping,
+// a stats update or a retry of what a visit left over came due, so idle connections cost next
+// to nothing. Once nothing has happened for a while it also wakes up less often.
+#define NET_QUEUE_CAPACITY 1024
+#define NET_THREAD_WAIT_MS 1
+#define NET_IDLE_WAIT_MS 10   // Wait while idle, commands from the game may sit this long
+#define NET_IDLE_AFTER_MS 1000
+#define NET_RETRY_MS 50       // Sends the socket did not take, held back messages, unreported disconnects
+#define NET_BIND_RETRY_MS 100
+#define NET_SERVER_CONNECTION 0 // The only connection a client has
+#define NET_JOIN_TIMEOUT_MS 5000 // How long a client waits for its ID before giving up
+#define NET_PING_INTERVAL_MS 1000
+#define NET_STATS_INTERVAL_MS 1000 // How often the game gets fresh statistics
+
+// A server's connection slots can be split into lanes, one per room, each with its own pair of
+// queues so a different thread can serve it. Lane n owns the slots from n times the lane size
+// on, and a new connection goes to the first lane with a free slot. Calls without a lane use
+// lane 0, the only one a client or a single match has.
+#define NET_LANE_QUEUE_MIN 64
+#define NET_LANE_QUEUE_PER_CONNECTION 16
+
+// Connection handles are a slot index plus the slot's generation. Slots are reused once the
+// game has been told about a disconnect, a handle kept past that no longer addresses anyone.
+#define NET_CONNECTION_INDEX(connection) ((connection) & 0xFFFF)
+
+typedef enum NetEventType {
+    NET_EVENT_CONNECTED,
+    NET_EVENT_DISCONNECTED,
+    NET_EVENT_MESSAGE
+} NetEventType;
+
+typedef struct NetEvent {
+    NetEventType type;
+    int connection; // Handle, see NET_CONNECTION_INDEX
+    Uint32 token; // Datagram binding token of a new connection, sent to the client with its ID
+    NetMessage message;
+} NetEvent;
+
+typedef enum NetChannel {
+    NET_CHANNEL_RELIABLE,
+    NET_CHANNEL_UNRELIABLE // Falls back to reliable until the peer's datagram address is bound
+} NetChannel;
+
+// An encoded message going to several connections, like a broadcast. It is encoded once and
+// each send only queues a reference; the network thread drops its references as it sends and
+// the last one frees the buffer. Whoever creates it holds the first reference.
+typedef struct NetSharedBuffer {
+    SDL_atomic_t references;
+    int length;
+    Uint8 data[NET_MAX_MESSAGE_SIZE];
+} NetSharedBuffer;
+
+// Joining connections advance one step per tick until they take part in regular traffic.
+typedef enum NetJoinState {
+    NET_JOIN_ASSIGN_ID,
+    NET_JOIN_SEND_WORLD,
+    NET_JOIN_ACTIVE
+} NetJoinState;
+
+bool network_start_server(Uint16 port, int connections_per_lane, int lanes);
+bool network_start_client(const char *host, Uint16 port);
+void network_stop(void);
+
+const NetEvent *network_peek_event(void);
+void network_pop_event(void);
+bool network_send(int connection, NetChannel channel, const Uint8 *data, int length);
+void network_disconnect(int connection);
+bool network_get_stats(int connection, NetStats *stats);
+
+const NetEvent *network_lane_peek_event(int lane);
+void network_lane_pop_event(int lane);
+bool network_lane_send(int lane, int connection, NetChannel channel, const Uint8 *data, int length);
+void network_lane_disconnect(int lane, int connection);
+
+NetSharedBuffer *network_shared_create(const Uint8 *data, int length);
+void network_shared_release(NetSharedBuffer *buffer);
+bool network_lane_send_shared(int lane, int connection, NetChannel channel, NetSharedBuffer *buffer);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef PLAYER_TABLE_H
+#define PLAYER_TABLE_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Game_Config.h"
+
+// A player ID is a slot index plus the slot's generation, so an ID held past the player's
+// removal stops resolving instead of pointing at whoever got the slot next.
+#define PLAYER_INDEX_BITS 10
+#define PLAYER_INDEX_MASK ((1 << PLAYER_INDEX_BITS) - 1)
+#define PLAYER_GENERATION_MASK (0xFFFF >> PLAYER_INDEX_BITS)
+#define PLAYER_TABLE_MAX ((1 << PLAYER_INDEX_BITS) - 1) // The last slot would reach PLAYER_NONE
+#define PLAYER_NONE 0xFFFF
+
+#define PLAYER_ID(index, generation) ((Uint16)(((generation) << PLAYER_INDEX_BITS) | (index)))
+#define PLAYER_INDEX(id) ((id) & PLAYER_INDEX_MASK)
+#define PLAYER_GENERATION(id) (((id) >> PLAYER_INDEX_BITS) & PLAYER_GENERATION_MASK)
+
+typedef struct PlayerTable {
+    Player *players;    // Indexed by slot, inactive slots are skipped by whoever iterates
+    Uint8 *generations;
+    int *free_slots;    // Stack of unused slots, lowest on top so IDs start small
+    int free_count;
+    int capacity;
+    int count;
+} PlayerTable;
+
+bool player_table_init(PlayerTable *table, int capacity);
+void player_table_destroy(PlayerTable *table);
+Player *player_table_add(PlayerTable *table);
+void player_table_remove(PlayerTable *table, int id);
+Player *player_table_get(PlayerTable *table, int id);
+Player *player_table_mirror(PlayerTable *table, int id);
+void player_table_unmirror(PlayerTable *table, int id);
+
+#endif
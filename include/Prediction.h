@@ -0,0 +1,24 @@
+#ifndef PREDICTION_H
+#define PREDICTION_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Game_Config.h"
+#include "Net_Protocol.h"
+
+// Must be a power of two and cover the inputs in flight over a round trip.
+#define PREDICTION_HISTORY 128
+#define PREDICTION_TOLERANCE 1.0f // Pixels; the server sends rounded positions, smaller errors are kept
+
+// Inputs the client applied ahead of the server, kept until the server confirms simulating them.
+typedef struct Prediction {
+    Uint8 inputs[PREDICTION_HISTORY];
+    Uint32 sequence; // Of the newest input, 0 before the first
+    Uint32 acked;    // Newest input the server has simulated
+} Prediction;
+
+void prediction_init(Prediction *prediction);
+bool prediction_apply(Prediction *prediction, Player *player, Uint8 input, float dt);
+bool prediction_pending(const Prediction *prediction, NetInput *message);
+void prediction_reconcile(Prediction *prediction, Player *player, Uint32 acked, float x, float y, float dt);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Game_Config.h"
+#include "Network.h"
+#include "Player_Table.h"
+#include "Net_Snapshot.h"
+#include "Spatial_Grid.h"
+
+// Area of interest: clients get updates of players around their view, players further away
+// only compete for one every AOI_TRICKLE_TICKS so outbound traffic stays bounded.
+#define AOI_VIEW_HALF_WIDTH (WINDOW_WIDTH / 2 + 128)
+#define AOI_VIEW_HALF_HEIGHT (WINDOW_HEIGHT / 2 + 128)
+#define AOI_TRICKLE_TICKS 30
+
+// Each snapshot has a budget for player state. Every player a client could get builds up
+// priority for each tick it goes unsent, faster the closer it is, and the snapshot takes the
+// highest first until the budget is spent. Far players only get a chance on their trickle
+// tick, but their priority keeps growing until they win one.
+#define SERVER_SNAPSHOT_BUDGET 256 // Bytes per client per tick, about 120 kbit/s at 60 Hz
+#define SERVER_PRIORITY_VIEW 1.0f  // Per tick unsent, at the edge of the view
+#define SERVER_PRIORITY_NEAR 4.0f  // More per tick, for a player right next to the viewer
+#define SERVER_PRIORITY_FAR 0.1f   // Per tick unsent, outside the view
+
+// Client inputs waiting to be simulated, one per tick. A client whose clock runs ahead builds
+// a backlog, beyond SERVER_INPUT_BACKLOG two are simulated per tick to catch up.
+#define SERVER_INPUT_QUEUE 32 // Power of two
+#define SERVER_INPUT_BACKLOG 4
+
+// Authoritative side of a match, shared by the hosting client and the headless dedicated server.
+typedef struct ClientSlot {
+    int connection; // Handle of the connection occupying the slot
+    int player_id;
+    NetJoinState join_state;
+    Uint32 token;
+    bool connected;
+    NetFrame *frames;   // What the client was sent over the last NET_FRAME_HISTORY ticks
+    Uint32 acked_tick;  // Newest of those the client confirmed, NET_NO_BASELINE before the first
+    Uint8 inputs[SERVER_INPUT_QUEUE]; // Indexed by input sequence
+    Uint32 input_received;  // Newest input sequence queued
+    Uint32 input_processed; // Newest input sequence simulated
+    Uint32 *sent_ticks;     // Tick each player slot was last sent at, its priority grows from there
+} ClientSlot;
+
+// A player that could go into a client's snapshot, see server_send_snapshot()
+typedef struct ServerCandidate {
+    int slot;
+    bool in_view;
+    float priority;
+    int cost; // Bits it adds to the snapshot when picked
+    NetPlayerState state;
+    const NetPlayerState *held; // What the client keeps in view when it is not picked, NULL for nothing
+} ServerCandidate;
+
+// One match: its players, its clients and its tick. Rooms share nothing but the network thread,
+// each is served on its own network lane by one thread at a time.
+typedef struct ServerRoom {
+    int lane;
+    int first_slot;      // Connection slot of the lane's first client
+    PlayerTable *players;
+    int host_id;         // The hosting client's own player, if there is one
+    ClientSlot *clients; // Indexed like the lane's connection slots
+    int max_clients;
+    int tick_rate;
+    SpatialGrid grid;     // Player slots by position
+    int *player_clients;  // Client slot of each player slot, -1 for none
+    int *nearby;          // Scratch for grid queries
+    Uint8 *framed;        // Scratch marking the player slots in the frame being built
+    NetFrame *frames;     // NET_FRAME_HISTORY frames for each client slot
+    Uint32 *sent_ticks;   // A player table's worth for each client slot
+    ServerCandidate *candidates; // Scratch for the snapshot being built
+    Uint32 tick_count;
+} ServerRoom;
+
+bool server_room_init(ServerRoom *room, int lane, PlayerTable *players, int max_clients, int tick_rate, const Player *host);
+void server_room_destroy(ServerRoom *room);
+void server_room_update(ServerRoom *room);
+void server_room_tick(ServerRoom *room, float dt);
+void server_room_print_stats(const ServerRoom *room);
+
+// The single match of a hosting client or a one-room dedicated server
+bool server_start(Uint16 port, PlayerTable *players, int max_clients, int tick_rate, const Player *host);
+void server_stop(void);
+void server_update(void);
+void server_tick(float dt);
+void server_print_stats(void);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SERVER_POOL_H
+#define SERVER_POOL_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Server.h"
+
+// Many independent rooms in one process, behind one port. Rooms are spread over a fixed pool of
+// worker threads, room r to worker r % workers, and stay there so a room's state is only ever
+// touched from one core. Each worker runs the fixed-tick loop over its own rooms.
+#define SERVER_POOL_MAX_ROOMS 256
+
+// A worker's numbers since the last report
+typedef struct ServerWorkerReport {
+    int rooms;
+    int players;
+    int ticks;
+    int overruns;     // Passes whose work took longer than a tick
+    double work_total; // Seconds, over the passes that ran ticks
+    double work_max;
+    int work_count;
+} ServerWorkerReport;
+
+bool server_pool_start(Uint16 port, int rooms, int players_per_room, int workers, int tick_rate);
+void server_pool_stop(void);
+int server_pool_workers(void);
+void server_pool_take_report(int worker, ServerWorkerReport *report);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Game_Config.h"
+
+#define INPUT_UP 0x01
+#define INPUT_DOWN 0x02
+#define INPUT_LEFT 0x04
+#define INPUT_RIGHT 0x08
+
+// Fixed-timestep clock: real time is accumulated and consumed in whole ticks, the remainder
+// is the fraction rendering interpolates by.
+typedef struct SimulationClock {
+    int tick_rate;
+    double tick_seconds;
+    double accumulator;
+    Uint64 last_counter;
+    Uint32 tick;
+} SimulationClock;
+
+int simulation_tick_rate(int tick_rate);
+void simulation_clock_init(SimulationClock *clock, int tick_rate);
+int simulation_clock_advance(SimulationClock *clock);
+float simulation_clock_alpha(const SimulationClock *clock);
+
+void simulation_init_player(Player *player, int id);
+void simulation_begin_tick(Player *players, int count);
+bool simulation_move_player(Player *player, Uint8 input, float dt);
+float simulation_lerp(float from, float to, float alpha);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Game_Config.h"
+
+// Uniform grid over the map. Entities are small integer indices (player slots) kept in
+// intrusive per-cell lists, so moving one between cells is O(1) and allocation free.
+#define SPATIAL_CELL_SIZE 256
+#define SPATIAL_GRID_WIDTH ((MAP_PIXEL_WIDTH + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE)
+#define SPATIAL_GRID_HEIGHT ((MAP_PIXEL_HEIGHT + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE)
+
+typedef struct SpatialGrid {
+    int heads[SPATIAL_GRID_HEIGHT][SPATIAL_GRID_WIDTH]; // First entity of each cell, -1 if empty
+    int *next;
+    int *prev;
+    int *cells; // Cell each entity is in, -1 when not in the grid
+    int capacity;
+} SpatialGrid;
+
+bool spatial_grid_init(SpatialGrid *grid, int capacity);
+void spatial_grid_destroy(SpatialGrid *grid);
+void spatial_grid_update(SpatialGrid *grid, int entity, float x, float y);
+void spatial_grid_remove(SpatialGrid *grid, int entity);
+int spatial_grid_query(const SpatialGrid *grid, float x, float y, float half_width, float half_height, int *entities, int max_entities);
+
+#endif
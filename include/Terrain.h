@@ -0,0 +1,29 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+#include "../SDL2/include/SDL.h"
+#include <stdbool.h>
+#include "Game_Config.h"
+
+#define TERRAIN_CHUNKS_X ((MAP_WIDTH + TERRAIN_CHUNK_TILES - 1) / TERRAIN_CHUNK_TILES)
+#define TERRAIN_CHUNKS_Y ((MAP_HEIGHT + TERRAIN_CHUNK_TILES - 1) / TERRAIN_CHUNK_TILES)
+
+// A block of TERRAIN_CHUNK_TILES x TERRAIN_CHUNK_TILES tiles baked into one render target.
+typedef struct TerrainChunk {
+    SDL_Texture *texture;
+    SDL_Rect rect;
+    bool dirty;
+} TerrainChunk;
+
+typedef struct Terrain {
+    SDL_Texture *tile_texture;
+    SDL_Color tiles[MAP_HEIGHT][MAP_WIDTH];
+    TerrainChunk chunks[TERRAIN_CHUNKS_Y][TERRAIN_CHUNKS_X];
+} Terrain;
+
+Terrain *terrain_create(SDL_Renderer *renderer, SDL_Texture *tile_texture);
+void terrain_destroy(Terrain *terrain);
+void terrain_set_tile(Terrain *terrain, int x, int y, SDL_Color tint);
+void terrain_invalidate(Terrain *terrain);
+void terrain_draw(Terrain *terrain, SDL_Renderer *renderer, const SDL_Rect *view);
+
+#endif
@@ -0,0 +1,38 @@
+#include "../include/Camera.h"
+
+void camera_init(Camera *camera, int w, int h) {
+    camera->view.x = 0;
+    camera->view.y = 0;
+    camera->view.w = w;
+    camera->view.h = h;
+}
+
+static int camera_clamp_axis(int position, int view_size, int map_size) {
+    if (map_size <= view_size) {
+        return (map_size - view_size) / 2;
+    }
+    if (position < 0) {
+        return 0;
+    }
+    if (position > map_size - view_size) {
+        return map_size - view_size;
+    }
+    return position;
+}
+
+// Centers the view on the target while keeping it inside the map.
+void camera_follow(Camera *camera, const SDL_Rect *target) {
+    int x = target->x + target->w / 2 - camera->view.w / 2;
+    int y = target->y + target->h / 2 - camera->view.h / 2;
+    camera->view.x = camera_clamp_axis(x, camera->view.w, MAP_PIXEL_WIDTH);
+    camera->view.y = camera_clamp_axis(y, camera->view.h, MAP_PIXEL_HEIGHT);
+}
+
+bool camera_is_visible(const Camera *camera, const SDL_Rect *rect) {
+    return SDL_HasIntersection(&camera->view, rect) == SDL_TRUE;
+}
+
+SDL_Rect camera_to_screen(const Camera *camera, const SDL_Rect *rect) {
+    SDL_Rect screen = { rect->x - camera->view.x, rect->y - camera->view.y, rect->w, rect->h };
+    return screen;
+}
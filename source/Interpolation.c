@@ -0,0 +1,139 @@
+#include "../include/Interpolation.h"
+#include "../include/Player_Table.h"
+#include "../include/Simulation.h"
+#include <stdlib.h>
+
+#define INTERPOLATION_MASK (INTERPOLATION_SAMPLES - 1)
+
+bool interpolation_init(Interpolation *interpolation, int capacity, float delay, float max_extrapolation) {
+    interpolation->tracks = (InterpolationTrack *)calloc(capacity, sizeof(InterpolationTrack));
+    if (!interpolation->tracks) {
+        interpolation->capacity = 0;
+        return false;
+    }
+    for (int i = 0; i < capacity; i++) {
+        interpolation->tracks[i].id = PLAYER_NONE;
+    }
+    interpolation->capacity = capacity;
+    interpolation->delay = delay;
+    interpolation->max_extrapolation = max_extrapolation;
+    interpolation->render_tick = 0.0;
+    interpolation->latest_tick = 0;
+    interpolation->since_latest = 0.0;
+    interpolation->started = false;
+    return true;
+}
+
+void interpolation_destroy(Interpolation *interpolation) {
+    free(interpolation->tracks);
+    interpolation->tracks = NULL;
+    interpolation->capacity = 0;
+}
+
+// Called once per snapshot before its players are pushed; the newest tick drives the render clock.
+void interpolation_receive(Interpolation *interpolation, Uint32 tick) {
+    if (!interpolation->started) {
+        interpolation->render_tick = (double)tick - interpolation->delay;
+        interpolation->started = true;
+    } else if ((Sint32)(tick - interpolation->latest_tick) <= 0) {
+        return;
+    }
+    interpolation->latest_tick = tick;
+    interpolation->since_latest = 0.0;
+}
+
+// Forgets a player's samples, one that shows up again starts from its next position.
+void interpolation_remove(Interpolation *interpolation, int id) {
+    int index = PLAYER_INDEX(id);
+    if (index < interpolation->capacity && interpolation->tracks[index].id == id) {
+        interpolation->tracks[index].id = PLAYER_NONE;
+        interpolation->tracks[index].count = 0;
+    }
+}
+
+// Samples arriving out of order are dropped, the ring only grows forward in time. After a long
+// gap (the player was out of view) the old samples are dropped too, blending across it would
+// slide the player over the map.
+void interpolation_push(Interpolation *interpolation, int id, Uint32 tick, float x, float y) {
+    int index = PLAYER_INDEX(id);
+    if (index >= interpolation->capacity) {
+        return;
+    }
+    InterpolationTrack *track = &interpolation->tracks[index];
+    if (track->id != id || (track->count > 0 && (Sint32)(tick - track->samples[track->newest].tick) > INTERPOLATION_MAX_GAP_TICKS)) {
+        track->id = id;
+        track->count = 0;
+        track->newest = 0;
+    } else if (track->count > 0 && (Sint32)(tick - track->samples[track->newest].tick) <= 0) {
+        return;
+    }
+
+    track->newest = (track->newest + (track->count > 0)) & INTERPOLATION_MASK;
+    track->samples[track->newest] = (InterpolationSample){tick, x, y};
+    if (track->count < INTERPOLATION_SAMPLES) {
+        track->count++;
+    }
+}
+
+// Moves the render clock on by local ticks. It aims for the delay behind where the server should
+// be by now, and eases towards that so snapshot jitter does not show as speed changes.
+void interpolation_advance(Interpolation *interpolation, float ticks) {
+    if (!interpolation->started) {
+        return;
+    }
+    interpolation->render_tick += ticks;
+    interpolation->since_latest += ticks;
+
+    double target = interpolation->latest_tick + interpolation->since_latest - interpolation->delay;
+    double error = target - interpolation->render_tick;
+    if (SDL_fabs(error) > INTERPOLATION_RESYNC_TICKS) {
+        interpolation->render_tick = target;
+    } else {
+        interpolation->render_tick += error * 0.05;
+    }
+}
+
+// Position of a player at the render clock plus the frame's fraction of a tick. Past the newest
+// sample the last known velocity is continued for a while, then the player holds still.
+bool interpolation_sample(const Interpolation *interpolation, int id, float alpha, float *x, float *y) {
+    int index = PLAYER_INDEX(id);
+    if (!interpolation->started || index >= interpolation->capacity) {
+        return false;
+    }
+    const InterpolationTrack *track = &interpolation->tracks[index];
+    if (track->id != id || track->count == 0) {
+        return false;
+    }
+
+    double time = interpolation->render_tick + alpha;
+    const InterpolationSample *newest = &track->samples[track->newest];
+    if (time >= newest->tick) {
+        *x = newest->x;
+        *y = newest->y;
+        if (track->count > 1) {
+            const InterpolationSample *previous = &track->samples[(track->newest - 1) & INTERPOLATION_MASK];
+            float span = (float)(newest->tick - previous->tick);
+            float ahead = SDL_min((float)(time - newest->tick), interpolation->max_extrapolation);
+            *x += (newest->x - previous->x) / span * ahead;
+            *y += (newest->y - previous->y) / span * ahead;
+        }
+        return true;
+    }
+
+    // Newest sample at or before the render time, and the one after it
+    for (int i = 1; i < track->count; i++) {
+        const InterpolationSample *from = &track->samples[(track->newest - i) & INTERPOLATION_MASK];
+        if (time >= from->tick) {
+            const InterpolationSample *to = &track->samples[(track->newest - i + 1) & INTERPOLATION_MASK];
+            float t = (float)((time - from->tick) / (to->tick - from->tick));
+            *x = simulation_lerp(from->x, to->x, t);
+            *y = simulation_lerp(from->y, to->y, t);
+            return true;
+        }
+    }
+
+    const InterpolationSample *oldest = &track->samples[(track->newest - track->count + 1) & INTERPOLATION_MASK];
+    *x = oldest->x;
+    *y = oldest->y;
+    return true;
+}
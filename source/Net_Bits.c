@@ -0,0 +1,86 @@
+#include "../include/Net_Bits.h"
+
+void net_bit_writer_init(NetBitWriter *writer, Uint8 *buffer, int capacity) {
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+    writer->bits = 0;
+    writer->overflow = false;
+}
+
+// Writes the low bits of the value, a byte at a time where the field allows.
+void net_bits_write(NetBitWriter *writer, Uint32 value, int bits) {
+    if (writer->overflow || writer->bits + bits > writer->capacity * 8) {
+        writer->overflow = true;
+        return;
+    }
+    while (bits > 0) {
+        int offset = writer->bits & 7;
+        int take = SDL_min(8 - offset, bits);
+        Uint8 *byte = &writer->buffer[writer->bits >> 3];
+        if (offset == 0) {
+            *byte = 0;
+        }
+        *byte |= (Uint8)((value & ((1u << take) - 1)) << offset);
+        value >>= take;
+        bits -= take;
+        writer->bits += take;
+    }
+}
+
+// Two's complement cut to the width, the reader extends the sign again.
+void net_bits_write_signed(NetBitWriter *writer, Sint32 value, int bits) {
+    net_bits_write(writer, (Uint32)value, bits);
+}
+
+// Bytes used, the last one padded with zero bits
+int net_bit_writer_bytes(const NetBitWriter *writer) {
+    return (writer->bits + 7) >> 3;
+}
+
+void net_bit_reader_init(NetBitReader *reader, const Uint8 *buffer, int length) {
+    reader->buffer = buffer;
+    reader->length = length;
+    reader->bits = 0;
+    reader->overflow = false;
+}
+
+// Reads past the end return 0 and set overflow.
+Uint32 net_bits_read(NetBitReader *reader, int bits) {
+    if (reader->overflow || reader->bits + bits > reader->length * 8) {
+        reader->overflow = true;
+        return 0;
+    }
+    Uint32 value = 0;
+    int shift = 0;
+    while (shift < bits) {
+        int offset = reader->bits & 7;
+        int take = SDL_min(8 - offset, bits - shift);
+        Uint32 chunk = (reader->buffer[reader->bits >> 3] >> offset) & ((1u << take) - 1);
+        value |= chunk << shift;
+        shift += take;
+        reader->bits += take;
+    }
+    return value;
+}
+
+Sint32 net_bits_read_signed(NetBitReader *reader, int bits) {
+    Uint32 value = net_bits_read(reader, bits);
+    if (bits < 32 && (value >> (bits - 1)) & 1) {
+        value |= ~0u << bits;
+    }
+    return (Sint32)value;
+}
+
+int net_bit_reader_bytes(const NetBitReader *reader) {
+    return (reader->bits + 7) >> 3;
+}
+
+bool net_bits_fit_signed(Sint32 value, int bits) {
+    Sint32 limit = (Sint32)1 << (bits - 1);
+    return value >= -limit && value < limit;
+}
+
+// Clamps a non-negative quantity into the range the width can carry.
+Uint32 net_quantize(Sint32 value, int bits) {
+    return (Uint32)SDL_clamp(value, 0, (Sint32)((1u << bits) - 1));
+}
@@ -0,0 +1,174 @@
+#include "../include/Net_Conditioner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct NetDelayedPacket {
+    UDPsocket socket;
+    bool outgoing;
+    Uint32 release; // SDL_GetTicks() when it goes out or may be received
+    IPaddress address;
+    int length;
+    Uint8 data[NET_MAX_MESSAGE_SIZE];
+} NetDelayedPacket;
+
+// Used by a single thread, the network thread in the game and the server
+static NetConditions conditions;
+static bool enabled = false;
+static NetDelayedPacket delayed[NET_CONDITIONER_CAPACITY];
+static int delayed_count = 0;
+static Uint32 random_state = 1;
+
+static Uint32 net_conditioner_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static bool net_conditioner_chance(float chance) {
+    return chance > 0.0f && (net_conditioner_random() & 0xFFFF) < chance * 0x10000;
+}
+
+static float net_conditions_percent(const char *value) {
+    return SDL_clamp((float)atof(value) / 100.0f, 0.0f, 1.0f);
+}
+
+// Takes one of --latency <ms>, --jitter <ms>, --loss <%>, --duplicate <%> or --reorder <%> at
+// argv[*i] and moves past its value. Returns false for any other argument.
+bool net_conditions_parse(NetConditions *conditions, int argc, char *argv[], int *i) {
+    if (*i + 1 >= argc) {
+        return false;
+    }
+    const char *option = argv[*i];
+    const char *value = argv[*i + 1];
+    if (strcmp(option, "--latency") == 0) {
+        conditions->latency_ms = SDL_max(atoi(value), 0);
+    } else if (strcmp(option, "--jitter") == 0) {
+        conditions->jitter_ms = SDL_max(atoi(value), 0);
+    } else if (strcmp(option, "--loss") == 0) {
+        conditions->loss = net_conditions_percent(value);
+    } else if (strcmp(option, "--duplicate") == 0) {
+        conditions->duplicate = net_conditions_percent(value);
+    } else if (strcmp(option, "--reorder") == 0) {
+        conditions->reorder = net_conditions_percent(value);
+    } else {
+        return false;
+    }
+    (*i)++;
+    return true;
+}
+
+// Call before networking starts.
+void net_conditioner_configure(const NetConditions *settings) {
+    conditions = *settings;
+    enabled = conditions.latency_ms > 0 || conditions.jitter_ms > 0 || conditions.loss > 0.0f ||
+              conditions.duplicate > 0.0f || conditions.reorder > 0.0f;
+    delayed_count = 0;
+    random_state = (Uint32)SDL_GetPerformanceCounter() | 1;
+    if (enabled) {
+        printf("Simulating network: %d ms latency, %d ms jitter, %.0f%% loss, %.0f%% duplicated, %.0f%% reordered\n",
+               conditions.latency_ms, conditions.jitter_ms, conditions.loss * 100.0f,
+               conditions.duplicate * 100.0f, conditions.reorder * 100.0f);
+    }
+}
+
+bool net_conditioner_enabled(void) {
+    return enabled;
+}
+
+// Lost datagrams simply never enter the queue, duplicates enter it twice with their own delay.
+static void net_conditioner_hold(UDPsocket socket, bool outgoing, const UDPpacket *packet) {
+    if (net_conditioner_chance(conditions.loss) || packet->len > NET_MAX_MESSAGE_SIZE) {
+        return;
+    }
+    int copies = net_conditioner_chance(conditions.duplicate) ? 2 : 1;
+    Uint32 now = SDL_GetTicks();
+    for (int i = 0; i < copies && delayed_count < NET_CONDITIONER_CAPACITY; i++) {
+        Uint32 delay = conditions.latency_ms;
+        if (conditions.jitter_ms > 0) {
+            delay += net_conditioner_random() % (conditions.jitter_ms + 1);
+        }
+        if (net_conditioner_chance(conditions.reorder)) {
+            delay += NET_CONDITIONER_REORDER_MS;
+        }
+        NetDelayedPacket *held = &delayed[delayed_count++];
+        held->socket = socket;
+        held->outgoing = outgoing;
+        held->release = now + delay;
+        held->address = packet->address;
+        held->length = packet->len;
+        memcpy(held->data, packet->data, packet->len);
+    }
+}
+
+// Index of the earliest held datagram that is due, -1 if none is. A NULL socket matches any.
+static int net_conditioner_due(UDPsocket socket, bool outgoing) {
+    Uint32 now = SDL_GetTicks();
+    int due = -1;
+    for (int i = 0; i < delayed_count; i++) {
+        const NetDelayedPacket *held = &delayed[i];
+        if (held->outgoing != outgoing || (socket && held->socket != socket) || (Sint32)(now - held->release) < 0) {
+            continue;
+        }
+        if (due < 0 || (Sint32)(held->release - delayed[due].release) < 0) {
+            due = i;
+        }
+    }
+    return due;
+}
+
+static void net_conditioner_remove(int index) {
+    delayed[index] = delayed[--delayed_count];
+}
+
+// Stands in for SDLNet_UDP_Send to a single address. The data is copied, the caller's buffer
+// is free again on return.
+int net_conditioner_send(UDPsocket socket, UDPpacket *packet) {
+    if (!enabled) {
+        return SDLNet_UDP_Send(socket, -1, packet);
+    }
+    net_conditioner_hold(socket, true, packet);
+    return 1;
+}
+
+// Stands in for SDLNet_UDP_Recv. Everything that arrived is held back first, then the earliest
+// datagram for this socket that is due comes out. Returns 1 with a datagram, 0 without.
+int net_conditioner_receive(UDPsocket socket, UDPpacket *packet) {
+    if (!enabled) {
+        return SDLNet_UDP_Recv(socket, packet);
+    }
+    while (SDLNet_UDP_Recv(socket, packet) > 0) {
+        net_conditioner_hold(socket, false, packet);
+    }
+
+    int index = net_conditioner_due(socket, false);
+    if (index < 0) {
+        return 0;
+    }
+    const NetDelayedPacket *held = &delayed[index];
+    int length = SDL_min(held->length, packet->maxlen);
+    memcpy(packet->data, held->data, length);
+    packet->len = length;
+    packet->address = held->address;
+    packet->channel = -1;
+    net_conditioner_remove(index);
+    return 1;
+}
+
+// Sends the outgoing datagrams that are due, call it every pass of the network loop.
+void net_conditioner_flush(void) {
+    int index;
+    while ((index = net_conditioner_due(NULL, true)) >= 0) {
+        NetDelayedPacket *held = &delayed[index];
+        UDPpacket packet;
+        packet.channel = -1;
+        packet.data = held->data;
+        packet.len = held->length;
+        packet.maxlen = held->length;
+        packet.status = 0;
+        packet.address = held->address;
+        SDLNet_UDP_Send(held->socket, -1, &packet);
+        net_conditioner_remove(index);
+    }
+}
@@ -0,0 +1,332 @@
+#include "../include/Net_Connection.h"
+#include "../include/Net_Conditioner.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <winsock2.h>
+typedef SOCKET NetSocketHandle;
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+typedef int NetSocketHandle;
+#endif
+
+#define NET_RING_MASK (NET_RING_BUFFER_SIZE - 1)
+
+// SDL_net has no non-blocking mode, but every 2.x release starts its TCP socket with these two
+// fields, which is enough to switch the OS socket over. SDLNet_TCP_Send then returns what the
+// socket took instead of waiting for the peer; receives only happen once the socket is ready.
+typedef struct NetSocketPrefix {
+    int ready;
+    NetSocketHandle channel;
+} NetSocketPrefix;
+
+// Checked against the vendored 2.2.0 only, any other release has to be checked again before this builds.
+SDL_COMPILE_TIME_ASSERT(net_socket_prefix, SDL_NET_MAJOR_VERSION == 2 && SDL_NET_MINOR_VERSION == 2 && SDL_NET_PATCHLEVEL == 0);
+
+#ifndef _WIN32
+// Works for UDP sockets as well, they start the same way.
+int net_socket_fd(const void *socket) {
+    return ((const NetSocketPrefix *)socket)->channel;
+}
+#endif
+
+static void net_socket_set_nonblocking(TCPsocket socket) {
+    NetSocketHandle channel = ((NetSocketPrefix *)socket)->channel;
+#ifdef _WIN32
+    u_long enabled = 1;
+    ioctlsocket(channel, FIONBIO, &enabled);
+#else
+    fcntl(channel, F_SETFL, fcntl(channel, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+void net_ring_buffer_clear(NetRingBuffer *ring) {
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+int net_ring_buffer_used(const NetRingBuffer *ring) {
+    return (int)(ring->tail - ring->head);
+}
+
+int net_ring_buffer_free(const NetRingBuffer *ring) {
+    return NET_RING_BUFFER_SIZE - net_ring_buffer_used(ring);
+}
+
+// Returns the number of bytes written, which is less than length when the buffer fills up.
+int net_ring_buffer_write(NetRingBuffer *ring, const void *data, int length) {
+    const Uint8 *bytes = (const Uint8 *)data;
+    length = SDL_min(length, net_ring_buffer_free(ring));
+
+    Uint32 offset = ring->tail & NET_RING_MASK;
+    int first = SDL_min(length, (int)(NET_RING_BUFFER_SIZE - offset));
+    memcpy(ring->data + offset, bytes, first);
+    memcpy(ring->data, bytes + first, length - first);
+    ring->tail += length;
+    return length;
+}
+
+// Copies the first length bytes out without consuming them; the caller checks net_ring_buffer_used first.
+void net_ring_buffer_peek(const NetRingBuffer *ring, void *data, int length) {
+    Uint8 *bytes = (Uint8 *)data;
+    Uint32 offset = ring->head & NET_RING_MASK;
+    int first = SDL_min(length, (int)(NET_RING_BUFFER_SIZE - offset));
+    memcpy(bytes, ring->data + offset, first);
+    memcpy(bytes + first, ring->data, length - first);
+}
+
+void net_ring_buffer_consume(NetRingBuffer *ring, int length) {
+    ring->head += length;
+}
+
+void net_connection_init(NetConnection *connection, TCPsocket socket) {
+    connection->socket = socket;
+    connection->closed = (socket == NULL);
+    connection->send_sequence = 0;
+    connection->udp_address.host = 0;
+    connection->udp_address.port = 0;
+    connection->udp_token = 0;
+    connection->udp_sequence = 0;
+    connection->udp_bound = false;
+    connection->send_progress_ticks = SDL_GetTicks();
+    SDL_zero(connection->stats);
+    connection->stats.rtt_ms = -1.0f;
+    net_ring_buffer_clear(&connection->receive_buffer);
+    net_ring_buffer_clear(&connection->send_buffer);
+    if (socket) {
+        net_socket_set_nonblocking(socket);
+    }
+}
+
+void net_connection_close(NetConnection *connection) {
+    if (connection->socket) {
+        SDLNet_TCP_Close(connection->socket);
+        connection->socket = NULL;
+    }
+    connection->closed = true;
+}
+
+// Reads straight into the free space of the receive buffer. With a socket set, keeps reading while
+// the socket stays ready so a whole burst is drained in one go; without one, does a single read.
+// The socket is non-blocking: if it was not ready SDLNet_TCP_Recv fails and the connection is
+// closed like when the peer went away. Returns the number of bytes received, or -1 then.
+int net_connection_receive(NetConnection *connection, SDLNet_SocketSet socket_set) {
+    NetRingBuffer *ring = &connection->receive_buffer;
+    int received = 0;
+
+    while (!connection->closed && net_ring_buffer_free(ring) > 0) {
+        Uint32 offset = ring->tail & NET_RING_MASK;
+        int space = SDL_min(net_ring_buffer_free(ring), (int)(NET_RING_BUFFER_SIZE - offset));
+        int len = SDLNet_TCP_Recv(connection->socket, ring->data + offset, space);
+        if (len <= 0) {
+            connection->closed = true;
+            return -1;
+        }
+        ring->tail += len;
+        received += len;
+        connection->stats.bytes_in += len;
+
+        if (!socket_set || SDLNet_CheckSockets(socket_set, 0) <= 0 || !SDLNet_SocketReady(connection->socket)) {
+            break;
+        }
+    }
+    return received;
+}
+
+// Reads until the socket would block or the receive buffer is full, for sockets that are only
+// reported when new data arrives. *drained says which; one that was not drained has to be read
+// again later without waiting for another report. Returns the number of bytes received, or -1
+// if the peer went away.
+int net_connection_receive_all(NetConnection *connection, bool *drained) {
+    NetRingBuffer *ring = &connection->receive_buffer;
+    NetSocketHandle channel = ((NetSocketPrefix *)connection->socket)->channel;
+    int received = 0;
+
+    *drained = true;
+    while (!connection->closed) {
+        if (net_ring_buffer_free(ring) == 0) {
+            *drained = false;
+            break;
+        }
+        Uint32 offset = ring->tail & NET_RING_MASK;
+        int space = SDL_min(net_ring_buffer_free(ring), (int)(NET_RING_BUFFER_SIZE - offset));
+        int len = recv(channel, (char *)ring->data + offset, space, 0);
+        if (len < 0) {
+#ifdef _WIN32
+            int error = WSAGetLastError();
+            if (error == WSAEWOULDBLOCK) {
+                break;
+            }
+#else
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+#endif
+        }
+        if (len <= 0) {
+            connection->closed = true;
+            return -1;
+        }
+        ring->tail += len;
+        received += len;
+        connection->stats.bytes_in += len;
+    }
+    return received;
+}
+
+// Hands every complete frame in the receive buffer to the handler and keeps any trailing
+// partial frame for the next read. Returns the number of messages dispatched, or -1 on a
+// protocol error, in which case the connection is marked closed.
+int net_connection_dispatch(NetConnection *connection, NetMessageHandler handler) {
+    NetRingBuffer *ring = &connection->receive_buffer;
+    Uint8 frame[NET_MAX_MESSAGE_SIZE];
+    int dispatched = 0;
+
+    while (net_ring_buffer_used(ring) >= NET_HEADER_SIZE) {
+        NetHeader header;
+        net_ring_buffer_peek(ring, frame, NET_HEADER_SIZE);
+        net_decode_header(frame, NET_HEADER_SIZE, &header);
+        if (header.length > NET_MAX_PAYLOAD) {
+            connection->closed = true;
+            return -1;
+        }
+
+        int frame_size = NET_HEADER_SIZE + header.length;
+        if (net_ring_buffer_used(ring) < frame_size) {
+            break;
+        }
+        net_ring_buffer_peek(ring, frame, frame_size);
+
+        NetMessage message;
+        if (net_decode_message(frame, frame_size, &message) < 0) {
+            printf("Dropping connection after malformed message (type %d)\n", header.type);
+            connection->closed = true;
+            return -1;
+        }
+        if (!handler(connection, &message)) {
+            break;
+        }
+        net_ring_buffer_consume(ring, frame_size);
+        connection->stats.messages_in++;
+        dispatched++;
+    }
+    return dispatched;
+}
+
+// Both senders stamp the connection's own sequence into the encoded message, so datagrams from
+// one peer always carry increasing sequences whichever channel the previous message took.
+// Stream messages are only queued here, net_connection_flush sends them. One that does not fit
+// would leave a gap in the stream, so the connection is closed instead.
+bool net_connection_send(NetConnection *connection, Uint8 *data, int length) {
+    if (connection->closed) {
+        return false;
+    }
+    if (net_ring_buffer_free(&connection->send_buffer) < length) {
+        printf("Dropping connection that stopped reading, %d bytes queued\n", net_connection_pending(connection));
+        connection->closed = true;
+        return false;
+    }
+    net_stamp_sequence(data, ++connection->send_sequence);
+    net_ring_buffer_write(&connection->send_buffer, data, length);
+    connection->stats.messages_out++;
+    return true;
+}
+
+// Hands the socket as much of the send buffer as it takes without waiting. Returns the number
+// of bytes sent; closes the connection once nothing could be sent for NET_SEND_STALL_MS.
+int net_connection_flush(NetConnection *connection) {
+    NetRingBuffer *ring = &connection->send_buffer;
+    int sent = 0;
+
+    while (!connection->closed && net_ring_buffer_used(ring) > 0) {
+        Uint32 offset = ring->head & NET_RING_MASK;
+        int length = SDL_min(net_ring_buffer_used(ring), (int)(NET_RING_BUFFER_SIZE - offset));
+        int len = SDLNet_TCP_Send(connection->socket, ring->data + offset, length);
+        if (len > 0) {
+            net_ring_buffer_consume(ring, len);
+            sent += len;
+            connection->stats.bytes_out += len;
+        }
+        if (len < length) {
+            break; // The socket is full, the rest waits for the next flush
+        }
+    }
+
+    Uint32 now = SDL_GetTicks();
+    if (sent > 0 || net_ring_buffer_used(ring) == 0) {
+        connection->send_progress_ticks = now;
+    } else if (!connection->closed && now - connection->send_progress_ticks > NET_SEND_STALL_MS) {
+        printf("Dropping connection that stopped reading for %d ms\n", NET_SEND_STALL_MS);
+        connection->closed = true;
+    }
+    return sent;
+}
+
+int net_connection_pending(const NetConnection *connection) {
+    return net_ring_buffer_used(&connection->send_buffer);
+}
+
+bool net_connection_send_datagram(NetConnection *connection, UDPsocket socket, Uint8 *data, int length) {
+    if (connection->closed) {
+        return false;
+    }
+    net_stamp_sequence(data, ++connection->send_sequence);
+    // The packet only borrows the caller's buffer, nothing is copied before the send
+    UDPpacket packet;
+    packet.channel = -1;
+    packet.data = data;
+    packet.len = length;
+    packet.maxlen = length;
+    packet.status = 0;
+    packet.address = connection->udp_address;
+    if (net_conditioner_send(socket, &packet) == 0) {
+        connection->stats.drops++;
+        return false;
+    }
+    connection->stats.messages_out++;
+    connection->stats.bytes_out += length;
+    return true;
+}
+
+// Datagrams are only taken from the bound address and only when newer than the last one,
+// late or duplicated packets carry stale state and are dropped.
+bool net_connection_accept_datagram(NetConnection *connection, const UDPpacket *packet, const NetHeader *header) {
+    if (packet->address.host != connection->udp_address.host || packet->address.port != connection->udp_address.port) {
+        return false;
+    }
+    if (connection->udp_sequence != 0 && (Sint32)(header->sequence - connection->udp_sequence) <= 0) {
+        connection->stats.drops++;
+        return false;
+    }
+    connection->udp_sequence = header->sequence;
+    connection->stats.messages_in++;
+    connection->stats.bytes_in += NET_HEADER_SIZE + header->length;
+    return true;
+}
+
+// Datagram binding tokens: a BIND with the right one moves a player's datagrams to the sender's
+// address, so they come from a xorshift generator seeded from the clock on first use.
+Uint32 net_connection_new_token(void) {
+    static Uint64 state = 0;
+    if (state == 0) {
+        state = (SDL_GetPerformanceCounter() ^ ((Uint64)time(NULL) << 32)) | 1;
+    }
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (Uint32)(state >> 32);
+}
+
+// Takes the time echoed back in a pong. Smoothed like TCP's round trip estimate, so a single
+// delayed datagram does not swing the number.
+void net_connection_measure_rtt(NetConnection *connection, Uint32 ping) {
+    float sample = (float)(SDL_GetTicks() - ping);
+    NetStats *stats = &connection->stats;
+    stats->rtt_ms = stats->rtt_ms >= 0.0f ? stats->rtt_ms + (sample - stats->rtt_ms) * 0.125f : sample;
+}
@@ -0,0 +1,125 @@
+#include "../include/Net_Poller.h"
+#include "../include/Net_Connection.h"
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef NET_USE_EPOLL
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#ifdef NET_USE_EPOLL
+
+bool net_poller_init(NetPoller *poller, int capacity) {
+    poller->capacity = capacity;
+    poller->epoll_fd = epoll_create1(0);
+    if (poller->epoll_fd < 0) {
+        printf("epoll_create1 failed\n");
+        return false;
+    }
+    return true;
+}
+
+void net_poller_destroy(NetPoller *poller) {
+    if (poller->epoll_fd >= 0) {
+        close(poller->epoll_fd);
+        poller->epoll_fd = -1;
+    }
+}
+
+static bool net_poller_add(NetPoller *poller, int fd, int key) {
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    event.data.u64 = (Uint64)(Sint64)key;
+    if (epoll_ctl(poller->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        printf("epoll_ctl failed to add socket %d\n", fd);
+        return false;
+    }
+    return true;
+}
+
+bool net_poller_add_tcp(NetPoller *poller, TCPsocket socket, int key) {
+    return net_poller_add(poller, net_socket_fd(socket), key);
+}
+
+bool net_poller_add_udp(NetPoller *poller, UDPsocket socket, int key) {
+    return net_poller_add(poller, net_socket_fd(socket), key);
+}
+
+// Must come before the socket is closed, the descriptor may be reused right after.
+void net_poller_remove_tcp(NetPoller *poller, TCPsocket socket, int key) {
+    struct epoll_event event; // Ignored, but kernels before 2.6.9 want the one it was added with
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    event.data.u64 = (Uint64)(Sint64)key;
+    epoll_ctl(poller->epoll_fd, EPOLL_CTL_DEL, net_socket_fd(socket), &event);
+}
+
+// Returns how many keys were written, hangups and errors are reported as readable so the
+// read that follows finds out.
+int net_poller_wait(NetPoller *poller, int timeout_ms, int *keys, int max_keys) {
+    struct epoll_event events[NET_POLL_EVENTS];
+    int count = epoll_wait(poller->epoll_fd, events, SDL_min(max_keys, NET_POLL_EVENTS), timeout_ms);
+    for (int i = 0; i < count; i++) {
+        keys[i] = (int)(Sint64)events[i].data.u64;
+    }
+    return SDL_max(count, 0);
+}
+
+#else
+
+bool net_poller_init(NetPoller *poller, int capacity) {
+    poller->capacity = capacity;
+    poller->set = SDLNet_AllocSocketSet(capacity + 2);
+    poller->sockets = (void **)calloc(capacity + 2, sizeof(void *));
+    if (!poller->set || !poller->sockets) {
+        printf("Failed to allocate socket set: %s\n", SDLNet_GetError());
+        net_poller_destroy(poller);
+        return false;
+    }
+    return true;
+}
+
+void net_poller_destroy(NetPoller *poller) {
+    if (poller->set) {
+        SDLNet_FreeSocketSet(poller->set);
+        poller->set = NULL;
+    }
+    free(poller->sockets);
+    poller->sockets = NULL;
+}
+
+bool net_poller_add_tcp(NetPoller *poller, TCPsocket socket, int key) {
+    if (SDLNet_TCP_AddSocket(poller->set, socket) < 0) {
+        return false;
+    }
+    poller->sockets[key + 2] = socket;
+    return true;
+}
+
+bool net_poller_add_udp(NetPoller *poller, UDPsocket socket, int key) {
+    if (SDLNet_UDP_AddSocket(poller->set, socket) < 0) {
+        return false;
+    }
+    poller->sockets[key + 2] = socket;
+    return true;
+}
+
+void net_poller_remove_tcp(NetPoller *poller, TCPsocket socket, int key) {
+    SDLNet_TCP_DelSocket(poller->set, socket);
+    poller->sockets[key + 2] = NULL;
+}
+
+// select() underneath, so every registered socket is checked after a wait.
+int net_poller_wait(NetPoller *poller, int timeout_ms, int *keys, int max_keys) {
+    if (SDLNet_CheckSockets(poller->set, timeout_ms) <= 0) {
+        return 0;
+    }
+    int count = 0;
+    for (int i = 0; i < poller->capacity + 2 && count < max_keys; i++) {
+        if (poller->sockets[i] && SDLNet_SocketReady(poller->sockets[i])) {
+            keys[count++] = i - 2;
+        }
+    }
+    return count;
+}
+
+#endif
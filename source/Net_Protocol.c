@@ -0,0 +1,403 @@
+#include "../include/Net_Protocol.h"
+#include "../include/Net_Bits.h"
+
+void net_write_u16(Uint8 *buffer, Uint16 value) {
+    buffer[0] = (Uint8)(value & 0xFF);
+    buffer[1] = (Uint8)(value >> 8);
+}
+
+void net_write_u32(Uint8 *buffer, Uint32 value) {
+    buffer[0] = (Uint8)(value & 0xFF);
+    buffer[1] = (Uint8)((value >> 8) & 0xFF);
+    buffer[2] = (Uint8)((value >> 16) & 0xFF);
+    buffer[3] = (Uint8)(value >> 24);
+}
+
+Uint16 net_read_u16(const Uint8 *buffer) {
+    return (Uint16)(buffer[0] | (buffer[1] << 8));
+}
+
+Uint32 net_read_u32(const Uint8 *buffer) {
+    return (Uint32)buffer[0] | ((Uint32)buffer[1] << 8) | ((Uint32)buffer[2] << 16) | ((Uint32)buffer[3] << 24);
+}
+
+// Byte-aligned payloads of a fixed size; entity state is packed, see net_encode_packed()
+static int net_payload_size(Uint8 type) {
+    switch (type) {
+    case NET_MSG_ID:
+    case NET_MSG_BIND:
+        return NET_BINDING_SIZE;
+    case NET_MSG_ACK:
+        return NET_ACK_SIZE;
+    case NET_MSG_PING:
+    case NET_MSG_PONG:
+        return NET_PING_SIZE;
+    case NET_MSG_LEAVE:
+        return NET_LEAVE_SIZE;
+    default:
+        return -1;
+    }
+}
+
+static bool net_is_packed(Uint8 type) {
+    return type == NET_MSG_INPUT || type == NET_MSG_SYNC || type == NET_MSG_WORLD || type == NET_MSG_SNAPSHOT;
+}
+
+// Field widths of the packed messages
+#define NET_INPUT_COUNT_BITS 5
+#define NET_WORLD_COUNT_BITS 8
+#define NET_BASELINE_OFFSET_BITS 6 // Baselines this close to the tick are sent as the distance
+
+SDL_COMPILE_TIME_ASSERT(map_fits_positions, MAP_PIXEL_WIDTH <= (1 << NET_POSITION_BITS) && MAP_PIXEL_HEIGHT <= (1 << NET_POSITION_BITS));
+SDL_COMPILE_TIME_ASSERT(counts_fit, NET_MAX_INPUTS < (1 << NET_INPUT_COUNT_BITS) && NET_MAX_WORLD_PLAYERS < (1 << NET_WORLD_COUNT_BITS) &&
+                                        NET_MAX_DELTA_ENTRIES < (1 << NET_ENTRY_COUNT_BITS) && NET_MAX_FAR_PLAYERS < (1 << NET_FAR_COUNT_BITS));
+
+// Worst case: the whole frame left (17 bits each) and a full frame came in (18 bits plus a position each)
+SDL_COMPILE_TIME_ASSERT(snapshot_fits, NET_SNAPSHOT_HEADER_BITS + NET_MAX_FRAME_PLAYERS * (17 + 18 + 2 * NET_POSITION_BITS) +
+                                           NET_MAX_FAR_PLAYERS * NET_PLAYER_STATE_BITS <= NET_MAX_PAYLOAD * 8);
+
+static void net_write_position(NetBitWriter *writer, Sint16 x, Sint16 y) {
+    net_bits_write(writer, net_quantize(x, NET_POSITION_BITS), NET_POSITION_BITS);
+    net_bits_write(writer, net_quantize(y, NET_POSITION_BITS), NET_POSITION_BITS);
+}
+
+static void net_read_position(NetBitReader *reader, Sint16 *x, Sint16 *y) {
+    *x = (Sint16)net_bits_read(reader, NET_POSITION_BITS);
+    *y = (Sint16)net_bits_read(reader, NET_POSITION_BITS);
+}
+
+static void net_write_player_state(NetBitWriter *writer, const NetPlayerState *state) {
+    net_bits_write(writer, state->id, 16);
+    net_write_position(writer, state->x, state->y);
+}
+
+static void net_read_player_state(NetBitReader *reader, NetPlayerState *state) {
+    state->id = (Uint16)net_bits_read(reader, 16);
+    net_read_position(reader, &state->x, &state->y);
+}
+
+// A changed axis is a bit for the size, then the change in as few bits as it fits
+static bool net_write_delta(NetBitWriter *writer, Sint16 value) {
+    bool small = net_bits_fit_signed(value, NET_DELTA_SMALL_BITS);
+    if (!small && !net_bits_fit_signed(value, NET_DELTA_BITS)) {
+        return false;
+    }
+    net_bits_write(writer, small, 1);
+    net_bits_write_signed(writer, value, small ? NET_DELTA_SMALL_BITS : NET_DELTA_BITS);
+    return true;
+}
+
+static Sint16 net_read_delta(NetBitReader *reader) {
+    return (Sint16)net_bits_read_signed(reader, net_bits_read(reader, 1) ? NET_DELTA_SMALL_BITS : NET_DELTA_BITS);
+}
+
+// Entries are a removed bit, then an added bit with the absolute position, or a bit per
+// changed axis with the change.
+static bool net_encode_snapshot(NetBitWriter *writer, const NetSnapshot *snapshot) {
+    if (snapshot->count > NET_MAX_DELTA_ENTRIES || snapshot->far_count > NET_MAX_FAR_PLAYERS) {
+        return false;
+    }
+    net_bits_write(writer, snapshot->tick, 32);
+    Uint32 offset = snapshot->tick - snapshot->baseline;
+    bool near = snapshot->baseline != NET_NO_BASELINE && offset < (1u << NET_BASELINE_OFFSET_BITS);
+    net_bits_write(writer, near, 1);
+    if (near) {
+        net_bits_write(writer, offset, NET_BASELINE_OFFSET_BITS);
+    } else {
+        net_bits_write(writer, snapshot->baseline, 32);
+    }
+    net_bits_write(writer, snapshot->input_ack, 32);
+    net_write_position(writer, snapshot->self_x, snapshot->self_y);
+    net_bits_write(writer, snapshot->count, NET_ENTRY_COUNT_BITS);
+    net_bits_write(writer, snapshot->far_count, NET_FAR_COUNT_BITS);
+
+    for (int i = 0; i < snapshot->count; i++) {
+        const NetDeltaEntry *entry = &snapshot->entries[i];
+        net_bits_write(writer, entry->id, 16);
+        net_bits_write(writer, (entry->flags & NET_DELTA_REMOVED) != 0, 1);
+        if (entry->flags & NET_DELTA_REMOVED) {
+            continue;
+        }
+        net_bits_write(writer, (entry->flags & NET_DELTA_ADDED) != 0, 1);
+        if (entry->flags & NET_DELTA_ADDED) {
+            net_write_position(writer, entry->x, entry->y);
+            continue;
+        }
+        net_bits_write(writer, (entry->flags & NET_DELTA_X) != 0, 1);
+        if ((entry->flags & NET_DELTA_X) && !net_write_delta(writer, entry->x)) {
+            return false;
+        }
+        net_bits_write(writer, (entry->flags & NET_DELTA_Y) != 0, 1);
+        if ((entry->flags & NET_DELTA_Y) && !net_write_delta(writer, entry->y)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < snapshot->far_count; i++) {
+        net_write_player_state(writer, &snapshot->far[i]);
+    }
+    return true;
+}
+
+static bool net_decode_snapshot(NetBitReader *reader, NetSnapshot *snapshot) {
+    snapshot->tick = net_bits_read(reader, 32);
+    if (net_bits_read(reader, 1)) {
+        snapshot->baseline = snapshot->tick - net_bits_read(reader, NET_BASELINE_OFFSET_BITS);
+    } else {
+        snapshot->baseline = net_bits_read(reader, 32);
+    }
+    snapshot->input_ack = net_bits_read(reader, 32);
+    net_read_position(reader, &snapshot->self_x, &snapshot->self_y);
+    snapshot->count = (Uint8)net_bits_read(reader, NET_ENTRY_COUNT_BITS);
+    snapshot->far_count = (Uint8)net_bits_read(reader, NET_FAR_COUNT_BITS);
+    if (snapshot->count > NET_MAX_DELTA_ENTRIES || snapshot->far_count > NET_MAX_FAR_PLAYERS) {
+        return false;
+    }
+
+    for (int i = 0; i < snapshot->count && !reader->overflow; i++) {
+        NetDeltaEntry *entry = &snapshot->entries[i];
+        entry->id = (Uint16)net_bits_read(reader, 16);
+        entry->x = 0;
+        entry->y = 0;
+        if (net_bits_read(reader, 1)) {
+            entry->flags = NET_DELTA_REMOVED;
+            continue;
+        }
+        if (net_bits_read(reader, 1)) {
+            entry->flags = NET_DELTA_ADDED;
+            net_read_position(reader, &entry->x, &entry->y);
+            continue;
+        }
+        entry->flags = 0;
+        if (net_bits_read(reader, 1)) {
+            entry->flags |= NET_DELTA_X;
+            entry->x = net_read_delta(reader);
+        }
+        if (net_bits_read(reader, 1)) {
+            entry->flags |= NET_DELTA_Y;
+            entry->y = net_read_delta(reader);
+        }
+    }
+    for (int i = 0; i < snapshot->far_count; i++) {
+        net_read_player_state(reader, &snapshot->far[i]);
+    }
+    return true;
+}
+
+static int net_delta_axis_bits(int change) {
+    if (change == 0) {
+        return 1;
+    }
+    return 2 + (net_bits_fit_signed(change, NET_DELTA_SMALL_BITS) ? NET_DELTA_SMALL_BITS : NET_DELTA_BITS);
+}
+
+// What a snapshot entry taking a player from one state to another costs on the wire, for
+// budgeting snapshots. From NULL the player is added, to NULL removed; no change costs nothing.
+int net_snapshot_entry_bits(const NetPlayerState *from, const NetPlayerState *to) {
+    if (!to) {
+        return 16 + 1;
+    }
+    if (!from) {
+        return 16 + 2 + 2 * NET_POSITION_BITS;
+    }
+    if (from->x == to->x && from->y == to->y) {
+        return 0;
+    }
+    return 16 + 2 + net_delta_axis_bits(to->x - from->x) + net_delta_axis_bits(to->y - from->y);
+}
+
+// Returns the payload size, or -1 if the message does not fit.
+static int net_encode_packed(const NetMessage *message, Uint8 *payload, int capacity) {
+    NetBitWriter writer;
+    net_bit_writer_init(&writer, payload, capacity);
+    switch (message->header.type) {
+    case NET_MSG_INPUT:
+        if (message->data.input.count > NET_MAX_INPUTS) {
+            return -1;
+        }
+        net_bits_write(&writer, message->data.input.count, NET_INPUT_COUNT_BITS);
+        net_bits_write(&writer, message->data.input.sequence, 32);
+        for (int i = 0; i < message->data.input.count; i++) {
+            net_bits_write(&writer, message->data.input.inputs[i], NET_INPUT_BITS);
+        }
+        break;
+    case NET_MSG_SYNC:
+        net_write_player_state(&writer, &message->data.player);
+        break;
+    case NET_MSG_WORLD:
+        if (message->data.world.count > NET_MAX_WORLD_PLAYERS) {
+            return -1;
+        }
+        net_bits_write(&writer, message->data.world.count, NET_WORLD_COUNT_BITS);
+        for (int i = 0; i < message->data.world.count; i++) {
+            net_write_player_state(&writer, &message->data.world.players[i]);
+        }
+        break;
+    case NET_MSG_SNAPSHOT:
+        if (!net_encode_snapshot(&writer, &message->data.snapshot)) {
+            return -1;
+        }
+        break;
+    }
+    return writer.overflow ? -1 : net_bit_writer_bytes(&writer);
+}
+
+// Fields are read without checks along the way, an overflow makes every later read zero, so
+// one test at the end is enough. The payload must be used up to the padding.
+static bool net_decode_packed(const Uint8 *payload, int length, NetMessage *message) {
+    NetBitReader reader;
+    net_bit_reader_init(&reader, payload, length);
+    switch (message->header.type) {
+    case NET_MSG_INPUT:
+        message->data.input.count = (Uint8)net_bits_read(&reader, NET_INPUT_COUNT_BITS);
+        message->data.input.sequence = net_bits_read(&reader, 32);
+        if (message->data.input.count > NET_MAX_INPUTS) {
+            return false;
+        }
+        for (int i = 0; i < message->data.input.count; i++) {
+            message->data.input.inputs[i] = (Uint8)net_bits_read(&reader, NET_INPUT_BITS);
+        }
+        break;
+    case NET_MSG_SYNC:
+        net_read_player_state(&reader, &message->data.player);
+        break;
+    case NET_MSG_WORLD:
+        message->data.world.count = (Uint8)net_bits_read(&reader, NET_WORLD_COUNT_BITS);
+        if (message->data.world.count > NET_MAX_WORLD_PLAYERS) {
+            return false;
+        }
+        for (int i = 0; i < message->data.world.count; i++) {
+            net_read_player_state(&reader, &message->data.world.players[i]);
+        }
+        break;
+    case NET_MSG_SNAPSHOT:
+        if (!net_decode_snapshot(&reader, &message->data.snapshot)) {
+            return false;
+        }
+        break;
+    }
+    return !reader.overflow && net_bit_reader_bytes(&reader) == length;
+}
+
+// Overwrites the sequence of an already encoded message, used by the sender right before it goes out.
+void net_stamp_sequence(Uint8 *buffer, Uint32 sequence) {
+    net_write_u32(buffer + 4, sequence);
+}
+
+bool net_decode_header(const Uint8 *buffer, int length, NetHeader *header) {
+    if (length < NET_HEADER_SIZE) {
+        return false;
+    }
+    header->version = buffer[0];
+    header->type = buffer[1];
+    header->length = net_read_u16(buffer + 2);
+    header->sequence = net_read_u32(buffer + 4);
+    return true;
+}
+
+// Returns the number of bytes written, or -1 if the message does not fit or has an unknown type.
+int net_encode_message(const NetMessage *message, Uint8 *buffer, int capacity) {
+    Uint8 *payload = buffer + NET_HEADER_SIZE;
+    int payload_size;
+    if (net_is_packed(message->header.type)) {
+        payload_size = net_encode_packed(message, payload, SDL_min(capacity - NET_HEADER_SIZE, NET_MAX_PAYLOAD));
+    } else {
+        payload_size = net_payload_size(message->header.type);
+    }
+    if (payload_size < 0 || NET_HEADER_SIZE + payload_size > capacity) {
+        return -1;
+    }
+
+    switch (message->header.type) {
+    case NET_MSG_ID:
+    case NET_MSG_BIND:
+        net_write_u16(payload, message->data.binding.id);
+        net_write_u32(payload + 2, message->data.binding.token);
+        net_write_u16(payload + 6, message->data.binding.tick_rate);
+        net_write_u32(payload + 8, message->data.binding.connection);
+        break;
+    case NET_MSG_ACK:
+        net_write_u32(payload, message->data.ack);
+        break;
+    case NET_MSG_PING:
+    case NET_MSG_PONG:
+        net_write_u32(payload, message->data.ping);
+        break;
+    case NET_MSG_LEAVE:
+        net_write_u16(payload, message->data.leave);
+        break;
+    }
+
+    buffer[0] = NET_PROTOCOL_VERSION;
+    buffer[1] = message->header.type;
+    net_write_u16(buffer + 2, (Uint16)payload_size);
+    net_write_u32(buffer + 4, message->header.sequence);
+    return NET_HEADER_SIZE + payload_size;
+}
+
+// Fills in the header and encodes into a NET_MAX_MESSAGE_SIZE buffer. The sequence is left
+// at zero, the network thread stamps the per-connection sequence when it actually sends.
+int net_encode(NetMessageType type, NetMessage *message, Uint8 *buffer) {
+    message->header.version = NET_PROTOCOL_VERSION;
+    message->header.type = type;
+    message->header.sequence = 0;
+    return net_encode_message(message, buffer, NET_MAX_MESSAGE_SIZE);
+}
+
+void net_player_state(NetPlayerState *state, const Player *player) {
+    state->id = (Uint16)player->id;
+    state->x = (Sint16)SDL_lroundf(player->x);
+    state->y = (Sint16)SDL_lroundf(player->y);
+}
+
+// Returns the number of bytes consumed, 0 if the buffer does not hold a complete message yet,
+// or -1 if the data is malformed (wrong version, oversized or inconsistent payload).
+// Messages of unknown type are consumed with their header filled in and no payload decoded.
+int net_decode_message(const Uint8 *buffer, int length, NetMessage *message) {
+    if (!net_decode_header(buffer, length, &message->header)) {
+        return 0;
+    }
+    if (message->header.version != NET_PROTOCOL_VERSION || message->header.length > NET_MAX_PAYLOAD) {
+        return -1;
+    }
+    if (length < NET_HEADER_SIZE + message->header.length) {
+        return 0;
+    }
+
+    const Uint8 *payload = buffer + NET_HEADER_SIZE;
+    if (net_is_packed(message->header.type)) {
+        if (!net_decode_packed(payload, message->header.length, message)) {
+            return -1;
+        }
+        return NET_HEADER_SIZE + message->header.length;
+    }
+
+    int expected = net_payload_size(message->header.type);
+    if (expected < 0) {
+        // Unknown types are skipped so older peers can ignore newer messages.
+        return NET_HEADER_SIZE + message->header.length;
+    }
+    if (message->header.length != expected) {
+        return -1;
+    }
+
+    switch (message->header.type) {
+    case NET_MSG_ID:
+    case NET_MSG_BIND:
+        message->data.binding.id = net_read_u16(payload);
+        message->data.binding.token = net_read_u32(payload + 2);
+        message->data.binding.tick_rate = net_read_u16(payload + 6);
+        message->data.binding.connection = net_read_u32(payload + 8);
+        break;
+    case NET_MSG_ACK:
+        message->data.ack = net_read_u32(payload);
+        break;
+    case NET_MSG_PING:
+    case NET_MSG_PONG:
+        message->data.ping = net_read_u32(payload);
+        break;
+    case NET_MSG_LEAVE:
+        message->data.leave = net_read_u16(payload);
+        break;
+    }
+    return NET_HEADER_SIZE + message->header.length;
+}
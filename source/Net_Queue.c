@@ -0,0 +1,53 @@
+#include "../include/Net_Queue.h"
+#include <stdlib.h>
+
+// Capacity must be a power of two; head and tail run freely and are masked on access.
+bool net_queue_init(NetQueue *queue, int capacity, int element_size) {
+    SDL_AtomicSet(&queue->head, 0);
+    SDL_AtomicSet(&queue->tail, 0);
+    queue->capacity = capacity;
+    queue->element_size = element_size;
+    queue->elements = (Uint8 *)malloc((size_t)capacity * element_size);
+    return queue->elements != NULL;
+}
+
+void net_queue_destroy(NetQueue *queue) {
+    free(queue->elements);
+    queue->elements = NULL;
+}
+
+// Producer side: returns the next free slot, or NULL when the consumer has fallen behind.
+void *net_queue_begin_push(NetQueue *queue) {
+    Uint32 tail = (Uint32)SDL_AtomicGet(&queue->tail);
+    Uint32 head = (Uint32)SDL_AtomicGet(&queue->head);
+    SDL_MemoryBarrierAcquire();
+    if (tail - head >= (Uint32)queue->capacity) {
+        return NULL;
+    }
+    return queue->elements + (size_t)(tail & (Uint32)(queue->capacity - 1)) * queue->element_size;
+}
+
+void net_queue_end_push(NetQueue *queue) {
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->tail, (int)((Uint32)SDL_AtomicGet(&queue->tail) + 1));
+}
+
+// Consumer side: returns the oldest element, or NULL when the queue is empty.
+void *net_queue_peek(NetQueue *queue) {
+    Uint32 head = (Uint32)SDL_AtomicGet(&queue->head);
+    Uint32 tail = (Uint32)SDL_AtomicGet(&queue->tail);
+    SDL_MemoryBarrierAcquire();
+    if (head == tail) {
+        return NULL;
+    }
+    return queue->elements + (size_t)(head & (Uint32)(queue->capacity - 1)) * queue->element_size;
+}
+
+void net_queue_pop(NetQueue *queue) {
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->head, (int)((Uint32)SDL_AtomicGet(&queue->head) + 1));
+}
+
+bool net_queue_full(NetQueue *queue) {
+    return (Uint32)SDL_AtomicGet(&queue->tail) - (Uint32)SDL_AtomicGet(&queue->head) >= (Uint32)queue->capacity;
+}
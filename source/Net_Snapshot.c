@@ -0,0 +1,143 @@
+#include "../include/Net_Snapshot.h"
+
+void net_frame_history_clear(NetFrame *frames) {
+    for (int i = 0; i < NET_FRAME_HISTORY; i++) {
+        frames[i].tick = NET_NO_BASELINE;
+        frames[i].count = 0;
+    }
+}
+
+// Returns the stored frame of that tick, or NULL if it was never stored or has been overwritten.
+const NetFrame *net_frame_history_find(const NetFrame *frames, Uint32 tick) {
+    if (tick == NET_NO_BASELINE) {
+        return NULL;
+    }
+    const NetFrame *frame = &frames[NET_FRAME_SLOT(tick)];
+    return frame->tick == tick ? frame : NULL;
+}
+
+// Frames are small and gathered nearly in order, insertion sort is all they need
+void net_frame_sort(NetFrame *frame) {
+    for (int i = 1; i < frame->count; i++) {
+        NetPlayerState state = frame->players[i];
+        int j = i - 1;
+        while (j >= 0 && frame->players[j].id > state.id) {
+            frame->players[j + 1] = frame->players[j];
+            j--;
+        }
+        frame->players[j + 1] = state;
+    }
+}
+
+const NetPlayerState *net_frame_find(const NetFrame *frame, Uint16 id) {
+    int low = 0, high = frame->count - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (frame->players[middle].id == id) {
+            return &frame->players[middle];
+        }
+        if (frame->players[middle].id < id) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return NULL;
+}
+
+static void net_snapshot_push(NetSnapshot *snapshot, Uint16 id, Uint8 flags, Sint16 x, Sint16 y) {
+    NetDeltaEntry *entry = &snapshot->entries[snapshot->count++];
+    entry->id = id;
+    entry->flags = flags;
+    entry->x = x;
+    entry->y = y;
+}
+
+// Walks both sorted frames together and records what the receiver has to change to get from the
+// baseline (NULL for none) to frame. Players that did not change cost nothing. Changes go out in
+// NET_DELTA_SMALL_BITS, or NET_DELTA_BITS when larger, which covers any move within the map.
+void net_snapshot_diff(const NetFrame *baseline, const NetFrame *frame, NetSnapshot *snapshot) {
+    int base_count = baseline ? baseline->count : 0;
+    int b = 0, f = 0;
+
+    snapshot->tick = frame->tick;
+    snapshot->baseline = baseline ? baseline->tick : NET_NO_BASELINE;
+    snapshot->count = 0;
+
+    while (b < base_count || f < frame->count) {
+        const NetPlayerState *old_state = b < base_count ? &baseline->players[b] : NULL;
+        const NetPlayerState *new_state = f < frame->count ? &frame->players[f] : NULL;
+
+        if (!new_state || (old_state && old_state->id < new_state->id)) {
+            net_snapshot_push(snapshot, old_state->id, NET_DELTA_REMOVED, 0, 0);
+            b++;
+        } else if (!old_state || new_state->id < old_state->id) {
+            net_snapshot_push(snapshot, new_state->id, NET_DELTA_ADDED, new_state->x, new_state->y);
+            f++;
+        } else {
+            Uint8 flags = 0;
+            if (new_state->x != old_state->x) flags |= NET_DELTA_X;
+            if (new_state->y != old_state->y) flags |= NET_DELTA_Y;
+            if (flags) {
+                net_snapshot_push(snapshot, new_state->id, flags,
+                                  (Sint16)(Uint16)(new_state->x - old_state->x),
+                                  (Sint16)(Uint16)(new_state->y - old_state->y));
+            }
+            b++;
+            f++;
+        }
+    }
+}
+
+// Rebuilds the frame a snapshot describes. Returns false if the snapshot does not fit the
+// baseline (entries out of order, changes to players the baseline does not have, too many players).
+bool net_snapshot_apply(const NetFrame *baseline, const NetSnapshot *snapshot, NetFrame *frame) {
+    int base_count = baseline ? baseline->count : 0;
+    int b = 0, e = 0;
+
+    frame->tick = snapshot->tick;
+    frame->count = 0;
+
+    while (b < base_count || e < snapshot->count) {
+        const NetPlayerState *old_state = b < base_count ? &baseline->players[b] : NULL;
+        const NetDeltaEntry *entry = e < snapshot->count ? &snapshot->entries[e] : NULL;
+        if (e > 0 && entry && entry->id <= snapshot->entries[e - 1].id) {
+            return false;
+        }
+
+        if (!entry || (old_state && old_state->id < entry->id)) {
+            if (frame->count == NET_MAX_FRAME_PLAYERS) {
+                return false;
+            }
+            frame->players[frame->count++] = *old_state;
+            b++;
+            continue;
+        }
+
+        bool matches = old_state && old_state->id == entry->id;
+        if (entry->flags & NET_DELTA_ADDED) {
+            if (matches || frame->count == NET_MAX_FRAME_PLAYERS) {
+                return false;
+            }
+            NetPlayerState *state = &frame->players[frame->count++];
+            state->id = entry->id;
+            state->x = entry->x;
+            state->y = entry->y;
+        } else if (!matches) {
+            return false;
+        } else if (!(entry->flags & NET_DELTA_REMOVED)) {
+            if (frame->count == NET_MAX_FRAME_PLAYERS) {
+                return false;
+            }
+            NetPlayerState *state = &frame->players[frame->count++];
+            *state = *old_state;
+            if (entry->flags & NET_DELTA_X) state->x = (Sint16)(Uint16)(old_state->x + entry->x);
+            if (entry->flags & NET_DELTA_Y) state->y = (Sint16)(Uint16)(old_state->y + entry->y);
+        }
+        if (matches) {
+            b++;
+        }
+        e++;
+    }
+    return true;
+}
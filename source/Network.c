@@ -0,0 +1,884 @@
+#include "../include/Network.h"
+#include "../include/Net_Connection.h"
+#include "../include/Net_Queue.h"
+#include "../include/Net_Conditioner.h"
+#include "../include/Net_Poller.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum NetCommandType {
+    NET_COMMAND_SEND,
+    NET_COMMAND_DISCONNECT
+} NetCommandType;
+
+typedef struct NetCommand {
+    NetCommandType type;
+    int connection;
+    NetChannel channel;
+    int length;
+    NetSharedBuffer *shared; // Sent instead of data when set, the command holds a reference
+    Uint8 data[NET_MAX_MESSAGE_SIZE];
+} NetCommand;
+
+// Every kind of timer has one period, so a list of them kept in the order they were started is
+// also in the order they come due and only its head needs checking.
+typedef enum NetTimer {
+    NET_TIMER_PING,
+    NET_TIMER_STATS,
+    NET_TIMER_RETRY,
+    NET_TIMER_COUNT
+} NetTimer;
+
+typedef struct NetTimerLink {
+    Uint32 due;
+    int prev, next; // Peers in the same list, -1 at either end
+    bool started;
+} NetTimerLink;
+
+typedef struct NetTimerList {
+    int head, tail;
+} NetTimerList;
+
+typedef struct NetPeer {
+    NetConnection connection; // Must stay first, handlers get the connection and cast back
+    bool disconnect_pending;  // Closed, but the game has not been told yet
+    bool in_use;
+    Uint16 generation;        // Bumped when the slot is freed
+    NetTimerLink timers[NET_TIMER_COUNT];
+    NetStats shared;          // Last published copy of the connection's stats, under stats_lock
+    int shared_handle;        // Connection the copy belongs to, -1 for none
+    Uint32 shared_ticks;      // When it was published
+    bool readable;            // Reported readable and not read until it would block yet
+    bool touched;             // In the list of peers to visit this pass
+    int address_next;         // Next peer in the same datagram address bucket, -1 at the end
+} NetPeer;
+
+// Everything below is owned by the network thread once it runs, except the queue ends that
+// belong to the game loop, or to the thread serving each lane.
+static SDL_Thread *network_thread = NULL;
+static SDL_atomic_t network_running;
+static NetQueue *events = NULL;   // One per lane
+static NetQueue *commands = NULL; // One per lane
+static int lane_count = 0;
+static int lane_size = 0;         // Connection slots per lane
+
+static bool is_server = false;
+static TCPsocket listen_socket = NULL;
+static UDPsocket udp_socket = NULL;
+static UDPpacket *udp_packet = NULL;
+static NetPoller poller;
+static bool poller_open = false;
+static bool listen_readable = false;
+static bool udp_readable = false;
+static NetPeer *peers = NULL;
+static int *touched_peers = NULL; // Visited on the next pass
+static int touched_count = 0;
+static NetTimerList timer_lists[NET_TIMER_COUNT];
+static const Uint32 timer_periods[NET_TIMER_COUNT] = {NET_PING_INTERVAL_MS, NET_STATS_INTERVAL_MS, NET_RETRY_MS};
+static Uint32 last_retry_ticks = 0; // Shared sockets
+static Uint32 last_activity_ticks = 0;
+static int *address_buckets = NULL; // Server peers by bound datagram address
+static int address_mask = 0;
+static int *free_peers = NULL;  // Stacks of unused slots, a lane's starts at its first slot
+static int *free_counts = NULL; // By lane
+static int peer_capacity = 0;
+static SDL_SpinLock stats_lock = 0;
+
+// Client side datagram binding, learned from the ID message
+static bool bind_known = false;
+static NetBinding bind_info;
+static Uint32 last_bind_ticks = 0;
+
+static int network_run(void *data);
+
+static int network_handle(int index) {
+    return (int)(((Uint32)peers[index].generation << 16) | (Uint32)index);
+}
+
+// Resolves a handle from the game, NULL if the connection it named is gone.
+static NetPeer *network_peer(int connection) {
+    int index = NET_CONNECTION_INDEX(connection);
+    if (connection < 0 || index >= peer_capacity || !peers[index].in_use || network_handle(index) != connection) {
+        return NULL;
+    }
+    return &peers[index];
+}
+
+static void network_stop_timer(int index, NetTimer timer) {
+    NetTimerLink *link = &peers[index].timers[timer];
+    NetTimerList *list = &timer_lists[timer];
+    if (!link->started) {
+        return;
+    }
+    if (link->prev >= 0) {
+        peers[link->prev].timers[timer].next = link->next;
+    } else {
+        list->head = link->next;
+    }
+    if (link->next >= 0) {
+        peers[link->next].timers[timer].prev = link->prev;
+    } else {
+        list->tail = link->prev;
+    }
+    link->started = false;
+}
+
+// Comes due one period from now, or from when it was started again.
+static void network_start_timer(int index, NetTimer timer, Uint32 now) {
+    NetTimerLink *link = &peers[index].timers[timer];
+    NetTimerList *list = &timer_lists[timer];
+    network_stop_timer(index, timer);
+    link->due = now + timer_periods[timer];
+    link->prev = list->tail;
+    link->next = -1;
+    link->started = true;
+    if (list->tail >= 0) {
+        peers[list->tail].timers[timer].next = index;
+    } else {
+        list->head = index;
+    }
+    list->tail = index;
+}
+
+// The peer whose timer of this kind is due, -1 when none is. It stays due until restarted or stopped.
+static int network_due_timer(NetTimer timer, Uint32 now) {
+    int index = timer_lists[timer].head;
+    return index >= 0 && SDL_TICKS_PASSED(now, peers[index].timers[timer].due) ? index : -1;
+}
+
+// Lanes get queues in proportion to their connections, dozens of rooms each with the full
+// capacity would take a lot of memory for nothing.
+static int network_queue_capacity(int lanes) {
+    int capacity = NET_QUEUE_CAPACITY;
+    while (lanes > 1 && capacity > NET_LANE_QUEUE_MIN && capacity / 2 >= lane_size * NET_LANE_QUEUE_PER_CONNECTION) {
+        capacity /= 2;
+    }
+    return capacity;
+}
+
+static bool network_open(int connections_per_lane, int lanes, Uint16 udp_port) {
+    int max_connections = connections_per_lane * lanes;
+    int buckets = 1;
+    while (buckets < max_connections * 2) {
+        buckets <<= 1;
+    }
+    peers = (NetPeer *)calloc(max_connections, sizeof(NetPeer));
+    free_peers = (int *)malloc(max_connections * sizeof(int));
+    free_counts = (int *)calloc(lanes, sizeof(int));
+    events = (NetQueue *)calloc(lanes, sizeof(NetQueue));
+    commands = (NetQueue *)calloc(lanes, sizeof(NetQueue));
+    touched_peers = (int *)malloc(max_connections * sizeof(int));
+    address_buckets = (int *)malloc(buckets * sizeof(int));
+    poller_open = net_poller_init(&poller, max_connections);
+    udp_socket = SDLNet_UDP_Open(udp_port);
+    udp_packet = SDLNet_AllocPacket(NET_MAX_MESSAGE_SIZE);
+    if (!peers || !free_peers || !free_counts || !events || !commands || !touched_peers || !address_buckets || !poller_open || !udp_socket || !udp_packet) {
+        printf("Failed to set up network: %s\n", SDLNet_GetError());
+        return false;
+    }
+    address_mask = buckets - 1;
+    for (int i = 0; i < buckets; i++) {
+        address_buckets[i] = -1;
+    }
+    touched_count = 0;
+    for (int timer = 0; timer < NET_TIMER_COUNT; timer++) {
+        timer_lists[timer].head = timer_lists[timer].tail = -1;
+    }
+    listen_readable = false;
+    udp_readable = false;
+    lane_count = lanes;
+    lane_size = connections_per_lane;
+    for (int lane = 0; lane < lanes; lane++) {
+        if (!net_queue_init(&events[lane], network_queue_capacity(lanes), sizeof(NetEvent)) ||
+            !net_queue_init(&commands[lane], network_queue_capacity(lanes), sizeof(NetCommand))) {
+            printf("Failed to allocate network queues\n");
+            return false;
+        }
+    }
+    peer_capacity = max_connections;
+    for (int i = 0; i < max_connections; i++) {
+        int lane = i / lane_size;
+        free_peers[lane * lane_size + free_counts[lane]++] = (lane + 1) * lane_size - 1 - (i - lane * lane_size);
+        peers[i].shared_handle = -1;
+        peers[i].address_next = -1;
+    }
+    return net_poller_add_udp(&poller, udp_socket, NET_POLL_DATAGRAM);
+}
+
+static bool network_launch(void) {
+    SDL_AtomicSet(&network_running, 1);
+    network_thread = SDL_CreateThread(network_run, "network", NULL);
+    if (!network_thread) {
+        printf("SDL_CreateThread: %s\n", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+bool network_start_server(Uint16 port, int connections_per_lane, int lanes) {
+    IPaddress ip;
+    if (SDLNet_ResolveHost(&ip, NULL, port) == -1) {
+        printf("SDLNet_ResolveHost: %s\n", SDLNet_GetError());
+        return false;
+    }
+
+    listen_socket = SDLNet_TCP_Open(&ip);
+    if (!listen_socket) {
+        printf("SDLNet_TCP_Open: %s\n", SDLNet_GetError());
+        return false;
+    }
+
+    is_server = true;
+    if (!network_open(connections_per_lane, lanes, port)) {
+        network_stop();
+        return false;
+    }
+    if (!net_poller_add_tcp(&poller, listen_socket, NET_POLL_LISTEN) || !network_launch()) {
+        network_stop();
+        return false;
+    }
+    return true;
+}
+
+bool network_start_client(const char *host, Uint16 port) {
+    IPaddress ip;
+    if (SDLNet_ResolveHost(&ip, host, port) == -1) {
+        printf("SDLNet_ResolveHost: %s\n", SDLNet_GetError());
+        return false;
+    }
+
+    TCPsocket socket = SDLNet_TCP_Open(&ip);
+    if (!socket) {
+        printf("SDLNet_TCP_Open: %s\n", SDLNet_GetError());
+        return false;
+    }
+
+    is_server = false;
+    if (!network_open(1, 1, 0)) {
+        SDLNet_TCP_Close(socket);
+        network_stop();
+        return false;
+    }
+
+    NetConnection *connection = &peers[NET_SERVER_CONNECTION].connection;
+    net_connection_init(connection, socket);
+    connection->udp_address = ip; // The server listens for datagrams on the same port
+    peers[NET_SERVER_CONNECTION].in_use = true;
+    free_counts[0] = 0;
+    network_start_timer(NET_SERVER_CONNECTION, NET_TIMER_PING, SDL_GetTicks());
+    network_start_timer(NET_SERVER_CONNECTION, NET_TIMER_STATS, SDL_GetTicks());
+    if (!net_poller_add_tcp(&poller, socket, NET_SERVER_CONNECTION) || !network_launch()) {
+        network_stop();
+        return false;
+    }
+    return true;
+}
+
+void network_stop(void) {
+    if (network_thread) {
+        SDL_AtomicSet(&network_running, 0);
+        SDL_WaitThread(network_thread, NULL);
+        network_thread = NULL;
+    }
+
+    for (int i = 0; i < peer_capacity; i++) {
+        if (peers[i].in_use) {
+            net_connection_close(&peers[i].connection);
+        }
+    }
+    if (listen_socket) {
+        SDLNet_TCP_Close(listen_socket);
+        listen_socket = NULL;
+    }
+    if (udp_socket) {
+        SDLNet_UDP_Close(udp_socket);
+        udp_socket = NULL;
+    }
+    if (udp_packet) {
+        SDLNet_FreePacket(udp_packet);
+        udp_packet = NULL;
+    }
+    if (poller_open) {
+        net_poller_destroy(&poller);
+        poller_open = false;
+    }
+    free(peers);
+    free(free_peers);
+    free(free_counts);
+    free(touched_peers);
+    free(address_buckets);
+    peers = NULL;
+    free_peers = NULL;
+    free_counts = NULL;
+    touched_peers = NULL;
+    address_buckets = NULL;
+    peer_capacity = 0;
+    for (int lane = 0; lane < lane_count; lane++) {
+        if (events) {
+            net_queue_destroy(&events[lane]);
+        }
+        if (commands && commands[lane].elements) {
+            // Commands never sent still hold references to shared buffers
+            NetCommand *command;
+            while ((command = (NetCommand *)net_queue_peek(&commands[lane])) != NULL) {
+                network_shared_release(command->shared);
+                net_queue_pop(&commands[lane]);
+            }
+            net_queue_destroy(&commands[lane]);
+        }
+    }
+    free(events);
+    free(commands);
+    events = NULL;
+    commands = NULL;
+    lane_count = 0;
+    lane_size = 0;
+}
+
+// Game loop side, or whichever thread serves the lane
+
+const NetEvent *network_peek_event(void) {
+    return network_lane_peek_event(0);
+}
+
+void network_pop_event(void) {
+    network_lane_pop_event(0);
+}
+
+bool network_send(int connection, NetChannel channel, const Uint8 *data, int length) {
+    return network_lane_send(0, connection, channel, data, length);
+}
+
+void network_disconnect(int connection) {
+    network_lane_disconnect(0, connection);
+}
+
+const NetEvent *network_lane_peek_event(int lane) {
+    if (lane >= lane_count || !events[lane].elements) {
+        return NULL;
+    }
+    return (const NetEvent *)net_queue_peek(&events[lane]);
+}
+
+void network_lane_pop_event(int lane) {
+    net_queue_pop(&events[lane]);
+}
+
+// Returns false when the command queue is full and the message was dropped.
+bool network_lane_send(int lane, int connection, NetChannel channel, const Uint8 *data, int length) {
+    if (lane >= lane_count || !commands[lane].elements || length <= 0 || length > NET_MAX_MESSAGE_SIZE) {
+        return false;
+    }
+    NetCommand *command = (NetCommand *)net_queue_begin_push(&commands[lane]);
+    if (!command) {
+        return false;
+    }
+    command->type = NET_COMMAND_SEND;
+    command->connection = connection;
+    command->channel = channel;
+    command->length = length;
+    command->shared = NULL;
+    memcpy(command->data, data, length);
+    net_queue_end_push(&commands[lane]);
+    return true;
+}
+
+// Copies the message once, with the caller's reference. NULL for no message or out of memory.
+NetSharedBuffer *network_shared_create(const Uint8 *data, int length) {
+    if (length <= 0 || length > NET_MAX_MESSAGE_SIZE) {
+        return NULL;
+    }
+    NetSharedBuffer *buffer = (NetSharedBuffer *)malloc(sizeof(NetSharedBuffer));
+    if (!buffer) {
+        return NULL;
+    }
+    SDL_AtomicSet(&buffer->references, 1);
+    buffer->length = length;
+    memcpy(buffer->data, data, length);
+    return buffer;
+}
+
+void network_shared_release(NetSharedBuffer *buffer) {
+    if (buffer && SDL_AtomicDecRef(&buffer->references)) {
+        free(buffer);
+    }
+}
+
+// Like network_lane_send, but the command only takes a reference to the buffer.
+bool network_lane_send_shared(int lane, int connection, NetChannel channel, NetSharedBuffer *buffer) {
+    if (lane >= lane_count || !commands[lane].elements) {
+        return false;
+    }
+    NetCommand *command = (NetCommand *)net_queue_begin_push(&commands[lane]);
+    if (!command) {
+        return false;
+    }
+    SDL_AtomicIncRef(&buffer->references);
+    command->type = NET_COMMAND_SEND;
+    command->connection = connection;
+    command->channel = channel;
+    command->length = buffer->length;
+    command->shared = buffer;
+    net_queue_end_push(&commands[lane]);
+    return true;
+}
+
+// Copies the statistics the network thread last published for the connection, at most
+// NET_STATS_INTERVAL_MS old. Returns false for connections that are gone.
+bool network_get_stats(int connection, NetStats *stats) {
+    int index = NET_CONNECTION_INDEX(connection);
+    if (!peers || connection < 0 || index >= peer_capacity) {
+        return false;
+    }
+    SDL_AtomicLock(&stats_lock);
+    bool found = peers[index].shared_handle == connection;
+    if (found) {
+        *stats = peers[index].shared;
+    }
+    SDL_AtomicUnlock(&stats_lock);
+    return found;
+}
+
+void network_lane_disconnect(int lane, int connection) {
+    if (lane >= lane_count || !commands[lane].elements) {
+        return;
+    }
+    NetCommand *command = (NetCommand *)net_queue_begin_push(&commands[lane]);
+    if (!command) {
+        return;
+    }
+    command->type = NET_COMMAND_DISCONNECT;
+    command->connection = connection;
+    command->length = 0;
+    command->shared = NULL;
+    net_queue_end_push(&commands[lane]);
+}
+
+// Network thread side
+
+static NetQueue *network_events(int index) {
+    return &events[index / lane_size];
+}
+
+static bool network_push_event(NetEventType type, int connection, Uint32 token) {
+    NetQueue *queue = network_events(NET_CONNECTION_INDEX(connection));
+    NetEvent *event = (NetEvent *)net_queue_begin_push(queue);
+    if (!event) {
+        return false;
+    }
+    event->type = type;
+    event->connection = connection;
+    event->token = token;
+    net_queue_end_push(queue);
+    return true;
+}
+
+// Pings and pongs go out on the datagram channel once it is bound, like per-tick state, so the
+// round trip is measured on the path snapshots take.
+static void network_send_ping(NetConnection *connection, NetMessageType type, Uint32 time) {
+    NetMessage message;
+    Uint8 buffer[NET_MAX_MESSAGE_SIZE];
+    message.data.ping = time;
+    int size = net_encode(type, &message, buffer);
+    if (connection->udp_bound) {
+        net_connection_send_datagram(connection, udp_socket, buffer, size);
+    } else {
+        net_connection_send(connection, buffer, size);
+    }
+}
+
+static bool network_queue_message(NetConnection *connection, const NetMessage *message) {
+    // Answered right here, a busy game loop would otherwise add to the round trip
+    if (message->header.type == NET_MSG_PING) {
+        network_send_ping(connection, NET_MSG_PONG, message->data.ping);
+        return true;
+    }
+    if (message->header.type == NET_MSG_PONG) {
+        net_connection_measure_rtt(connection, message->data.ping);
+        return true;
+    }
+
+    int index = (int)((NetPeer *)connection - peers);
+    NetEvent *event = (NetEvent *)net_queue_begin_push(network_events(index));
+    if (!event) {
+        return false;
+    }
+    if (!is_server && message->header.type == NET_MSG_ID) {
+        bind_info = message->data.binding;
+        bind_known = true;
+    }
+    event->type = NET_EVENT_MESSAGE;
+    event->connection = network_handle(index);
+    event->token = 0;
+    event->message = *message;
+    net_queue_end_push(network_events(index));
+    return true;
+}
+
+// Queues a peer for a visit at the end of this pass, see network_update_peer.
+static void network_touch(int index) {
+    if (!peers[index].touched) {
+        peers[index].touched = true;
+        touched_peers[touched_count++] = index;
+    }
+}
+
+static int *network_address_bucket(const IPaddress *address) {
+    Uint32 hash = (address->host ^ ((Uint32)address->port << 16) ^ address->port) * 2654435761u;
+    return &address_buckets[(hash ^ (hash >> 15)) & address_mask];
+}
+
+// Server side, finds the peer bound to a datagram address without looking at every peer.
+static int network_find_address(const IPaddress *address) {
+    int index = *network_address_bucket(address);
+    while (index >= 0) {
+        const IPaddress *bound = &peers[index].connection.udp_address;
+        if (bound->host == address->host && bound->port == address->port) {
+            return index;
+        }
+        index = peers[index].address_next;
+    }
+    return -1;
+}
+
+static void network_unbind_address(int index) {
+    NetConnection *connection = &peers[index].connection;
+    if (!connection->udp_bound) {
+        return;
+    }
+    int *link = network_address_bucket(&connection->udp_address);
+    while (*link >= 0 && *link != index) {
+        link = &peers[*link].address_next;
+    }
+    if (*link == index) {
+        *link = peers[index].address_next;
+    }
+    peers[index].address_next = -1;
+    connection->udp_bound = false;
+}
+
+static void network_bind_address(int index, const IPaddress *address) {
+    NetConnection *connection = &peers[index].connection;
+    network_unbind_address(index);
+    int *bucket = network_address_bucket(address);
+    connection->udp_address = *address;
+    connection->udp_bound = true;
+    peers[index].address_next = *bucket;
+    *bucket = index;
+}
+
+// A lane only gets to address its own connections. Returns how many commands there were.
+static int network_flush_commands(int lane) {
+    NetCommand *command;
+    int count = 0;
+    while ((command = (NetCommand *)net_queue_peek(&commands[lane])) != NULL) {
+        NetPeer *peer = network_peer(command->connection);
+        if (peer && NET_CONNECTION_INDEX(command->connection) / lane_size == lane) {
+            NetConnection *connection = &peer->connection;
+            Uint8 *data = command->shared ? command->shared->data : command->data;
+            network_touch((int)(peer - peers));
+            if (command->type == NET_COMMAND_DISCONNECT) {
+                connection->closed = true;
+            } else if (command->channel == NET_CHANNEL_UNRELIABLE && connection->udp_bound) {
+                net_connection_send_datagram(connection, udp_socket, data, command->length);
+            } else if (command->channel == NET_CHANNEL_UNRELIABLE && net_connection_pending(connection) > NET_SEND_STATE_LIMIT) {
+                connection->stats.drops++; // Per-tick state over a backed up stream, the next tick replaces it
+            } else {
+                net_connection_send(connection, data, command->length);
+            }
+        }
+        network_shared_release(command->shared);
+        net_queue_pop(&commands[lane]);
+        count++;
+    }
+    return count;
+}
+
+// First lane with a free slot, so rooms fill up one after the other. -1 when all are full.
+static int network_pick_lane(void) {
+    for (int lane = 0; lane < lane_count; lane++) {
+        if (free_counts[lane] > 0) {
+            return lane;
+        }
+    }
+    return -1;
+}
+
+// Takes every connection waiting on the listen socket. Returns false when some are left because
+// the game has not caught up with its events, they are taken on a later pass.
+static bool network_accept(void) {
+    for (;;) {
+        int lane = network_pick_lane();
+        if (lane >= 0 && net_queue_full(&events[lane])) {
+            return false;
+        }
+        TCPsocket socket = SDLNet_TCP_Accept(listen_socket);
+        if (!socket) {
+            return true;
+        }
+        if (lane < 0) {
+            printf("Rejecting connection, server is full\n");
+            SDLNet_TCP_Close(socket);
+            continue;
+        }
+
+        int index = free_peers[lane * lane_size + --free_counts[lane]];
+        NetPeer *peer = &peers[index];
+        net_connection_init(&peer->connection, socket);
+        peer->connection.udp_token = net_connection_new_token();
+        peer->disconnect_pending = false;
+        peer->readable = true; // Data may have arrived before it was registered
+        network_start_timer(index, NET_TIMER_PING, SDL_GetTicks());
+        network_start_timer(index, NET_TIMER_STATS, SDL_GetTicks());
+        peer->address_next = -1;
+        peer->in_use = true;
+        if (!net_poller_add_tcp(&poller, socket, index)) {
+            peer->connection.closed = true;
+        }
+        network_touch(index);
+        network_push_event(NET_EVENT_CONNECTED, network_handle(index), peer->connection.udp_token);
+    }
+}
+
+static void network_receive_datagram(const NetMessage *message) {
+    if (!is_server) {
+        NetConnection *connection = &peers[NET_SERVER_CONNECTION].connection;
+        if (net_connection_accept_datagram(connection, udp_packet, &message->header)) {
+            connection->udp_bound = true;
+            if (!network_queue_message(connection, message)) {
+                connection->stats.drops++;
+            }
+        }
+        return;
+    }
+
+    if (message->header.type == NET_MSG_BIND) {
+        // Rare, a client repeats it only until its first datagram from us arrives
+        int handle = (int)message->data.binding.connection;
+        NetPeer *peer = network_peer(handle);
+        if (!peer || peer->connection.closed || message->data.binding.token != peer->connection.udp_token) {
+            return;
+        }
+        int index = NET_CONNECTION_INDEX(handle);
+        if (!peer->connection.udp_bound) {
+            printf("Connection %d bound datagram address\n", index);
+        }
+        network_bind_address(index, &udp_packet->address);
+        peer->connection.udp_sequence = message->header.sequence;
+        return;
+    }
+
+    int index = network_find_address(&udp_packet->address);
+    if (index < 0) {
+        return;
+    }
+    NetConnection *connection = &peers[index].connection;
+    if (!connection->closed && net_connection_accept_datagram(connection, udp_packet, &message->header) &&
+        !network_queue_message(connection, message)) {
+        connection->stats.drops++;
+    }
+}
+
+// Every datagram holds one or more complete messages; when the game falls behind they are dropped
+static void network_receive_datagrams(void) {
+    while (net_conditioner_receive(udp_socket, udp_packet) > 0) {
+        NetMessage message;
+        int offset = 0;
+        int used;
+        while (offset < udp_packet->len && (used = net_decode_message(udp_packet->data + offset, udp_packet->len - offset, &message)) > 0) {
+            offset += used;
+            network_receive_datagram(&message);
+        }
+    }
+}
+
+// Keep announcing our datagram address until the server's first datagram proves it arrived
+static void network_send_bind(void) {
+    NetConnection *connection = &peers[NET_SERVER_CONNECTION].connection;
+    Uint32 now = SDL_GetTicks();
+    if (!bind_known || connection->udp_bound || connection->closed || now - last_bind_ticks < NET_BIND_RETRY_MS) {
+        return;
+    }
+    last_bind_ticks = now;
+
+    NetMessage message;
+    Uint8 buffer[NET_MAX_MESSAGE_SIZE];
+    message.header.type = NET_MSG_BIND;
+    message.header.sequence = 0;
+    message.data.binding = bind_info;
+    int size = net_encode_message(&message, buffer, sizeof(buffer));
+    net_connection_send_datagram(connection, udp_socket, buffer, size);
+}
+
+// Reads what arrived, hands complete messages to the game and sends what is queued.
+static void network_update_peer(int index) {
+    NetPeer *peer = &peers[index];
+    NetConnection *connection = &peer->connection;
+
+    if (connection->socket) {
+        if (peer->readable) {
+            bool drained;
+            net_connection_receive_all(connection, &drained);
+            peer->readable = !drained;
+        }
+        net_connection_dispatch(connection, network_queue_message);
+        net_connection_flush(connection);
+
+        if (connection->closed) {
+            net_poller_remove_tcp(&poller, connection->socket, index);
+            net_connection_close(connection);
+            if (is_server) {
+                network_unbind_address(index);
+            }
+            peer->readable = false;
+            peer->disconnect_pending = true;
+        }
+    }
+
+    // Once the game knows, the slot can go to the next connection under a new generation
+    if (peer->disconnect_pending && network_push_event(NET_EVENT_DISCONNECTED, network_handle(index), 0)) {
+        peer->disconnect_pending = false;
+        if (is_server) {
+            for (int timer = 0; timer < NET_TIMER_COUNT; timer++) {
+                network_stop_timer(index, timer);
+            }
+            SDL_AtomicLock(&stats_lock);
+            peer->shared_handle = -1;
+            SDL_AtomicUnlock(&stats_lock);
+            peer->in_use = false;
+            peer->generation = (Uint16)((peer->generation + 1) & 0x7FFF);
+            int lane = index / lane_size;
+            free_peers[lane * lane_size + free_counts[lane]++] = index;
+        }
+    }
+}
+
+// Hands the game a copy of the connection's stats, with the rates since the last copy.
+static void network_publish_stats(int index, Uint32 now) {
+    NetPeer *peer = &peers[index];
+    NetStats *stats = &peer->connection.stats;
+    int handle = network_handle(index);
+    float seconds = (now - peer->shared_ticks) / 1000.0f;
+
+    SDL_AtomicLock(&stats_lock);
+    if (peer->shared_handle == handle && seconds > 0.0f) {
+        stats->kbps_in = (stats->bytes_in - peer->shared.bytes_in) * 8 / 1000.0f / seconds;
+        stats->kbps_out = (stats->bytes_out - peer->shared.bytes_out) * 8 / 1000.0f / seconds;
+        stats->messages_in_rate = (stats->messages_in - peer->shared.messages_in) / seconds;
+        stats->messages_out_rate = (stats->messages_out - peer->shared.messages_out) / seconds;
+    }
+    stats->send_queue = net_connection_pending(&peer->connection);
+    peer->shared = *stats;
+    peer->shared_handle = handle;
+    peer->shared_ticks = now;
+    SDL_AtomicUnlock(&stats_lock);
+}
+
+// Visits the peers whose timers came due, and now and then tries the shared sockets in case
+// a report was missed.
+static void network_run_timers(void) {
+    Uint32 now = SDL_GetTicks();
+    int index;
+    while ((index = network_due_timer(NET_TIMER_PING, now)) >= 0) {
+        network_start_timer(index, NET_TIMER_PING, now);
+        if (!peers[index].connection.closed) {
+            network_send_ping(&peers[index].connection, NET_MSG_PING, now);
+            network_touch(index);
+        }
+    }
+    while ((index = network_due_timer(NET_TIMER_STATS, now)) >= 0) {
+        network_start_timer(index, NET_TIMER_STATS, now);
+        network_publish_stats(index, now);
+    }
+    while ((index = network_due_timer(NET_TIMER_RETRY, now)) >= 0) {
+        network_stop_timer(index, NET_TIMER_RETRY);
+        network_touch(index);
+    }
+    if (now - last_retry_ticks >= NET_RETRY_MS) {
+        last_retry_ticks = now;
+        listen_readable = listen_socket != NULL;
+        udp_readable = true;
+    }
+}
+
+// A visit can leave work the socket gives no notice of: sends it did not take, messages the
+// full event queue held back, or a disconnect the game has not been told about.
+static bool network_peer_stalled(const NetPeer *peer) {
+    const NetConnection *connection = &peer->connection;
+    return peer->disconnect_pending || net_connection_pending(connection) > 0 || net_ring_buffer_used(&connection->receive_buffer) > 0;
+}
+
+// Short waits while there is traffic, so game commands go out right away. Once idle, up to
+// the next timer.
+static int network_wait_ms(Uint32 now) {
+    if (now - last_activity_ticks < NET_IDLE_AFTER_MS || net_conditioner_enabled()) {
+        return NET_THREAD_WAIT_MS;
+    }
+    Uint32 next = last_retry_ticks + NET_RETRY_MS;
+    for (int timer = 0; timer < NET_TIMER_COUNT; timer++) {
+        int index = timer_lists[timer].head;
+        if (index >= 0 && (Sint32)(peers[index].timers[timer].due - next) < 0) {
+            next = peers[index].timers[timer].due;
+        }
+    }
+    return SDL_clamp((Sint32)(next - now), NET_THREAD_WAIT_MS, NET_IDLE_WAIT_MS);
+}
+
+static int network_run(void *data) {
+    (void)data;
+    int ready[NET_POLL_EVENTS];
+    while (SDL_AtomicGet(&network_running)) {
+        int flushed = 0;
+        for (int lane = 0; lane < lane_count; lane++) {
+            flushed += network_flush_commands(lane);
+        }
+
+        int count = net_poller_wait(&poller, network_wait_ms(SDL_GetTicks()), ready, NET_POLL_EVENTS);
+        if (flushed > 0 || count > 0) {
+            last_activity_ticks = SDL_GetTicks();
+        }
+        for (int i = 0; i < count; i++) {
+            if (ready[i] == NET_POLL_LISTEN) {
+                listen_readable = true;
+            } else if (ready[i] == NET_POLL_DATAGRAM) {
+                udp_readable = true;
+            } else if (ready[i] >= 0 && ready[i] < peer_capacity && peers[ready[i]].in_use) {
+                peers[ready[i]].readable = true;
+                network_touch(ready[i]);
+            }
+        }
+
+        if (listen_readable) {
+            listen_readable = !network_accept();
+        }
+        // Held back datagrams come due without the socket getting ready
+        if (udp_readable || net_conditioner_enabled()) {
+            network_receive_datagrams();
+            udp_readable = false;
+        }
+        network_run_timers();
+
+        // Peers still readable after their visit had a full buffer, they go again next pass
+        int visits = touched_count;
+        touched_count = 0;
+        for (int i = 0; i < visits; i++) {
+            int index = touched_peers[i];
+            NetPeer *peer = &peers[index];
+            peer->touched = false;
+            if (peer->in_use) {
+                network_update_peer(index);
+            }
+            if (peer->in_use && peer->readable) {
+                network_touch(index);
+            } else if (peer->in_use && network_peer_stalled(peer) && !peer->timers[NET_TIMER_RETRY].started) {
+                network_start_timer(index, NET_TIMER_RETRY, SDL_GetTicks());
+            }
+        }
+        if (!is_server) {
+            network_send_bind();
+        }
+        net_conditioner_flush();
+    }
+    return 0;
+}
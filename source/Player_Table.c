@@ -0,0 +1,108 @@
+#include "../include/Player_Table.h"
+#include "../include/Simulation.h"
+#include <stdlib.h>
+
+bool player_table_init(PlayerTable *table, int capacity) {
+    capacity = SDL_clamp(capacity, 1, PLAYER_TABLE_MAX);
+    table->players = (Player *)calloc(capacity, sizeof(Player));
+    table->generations = (Uint8 *)calloc(capacity, sizeof(Uint8));
+    table->free_slots = (int *)malloc(capacity * sizeof(int));
+    if (!table->players || !table->generations || !table->free_slots) {
+        player_table_destroy(table);
+        return false;
+    }
+
+    for (int i = 0; i < capacity; i++) {
+        simulation_init_player(&table->players[i], PLAYER_ID(i, 0));
+        table->free_slots[i] = capacity - 1 - i;
+    }
+    table->free_count = capacity;
+    table->capacity = capacity;
+    table->count = 0;
+    return true;
+}
+
+void player_table_destroy(PlayerTable *table) {
+    free(table->players);
+    free(table->generations);
+    free(table->free_slots);
+    table->players = NULL;
+    table->generations = NULL;
+    table->free_slots = NULL;
+    table->free_count = 0;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+// Takes a free slot for a new player at the spawn point, returns NULL when the table is full.
+Player *player_table_add(PlayerTable *table) {
+    if (table->free_count == 0) {
+        return NULL;
+    }
+    int index = table->free_slots[--table->free_count];
+    Player *player = &table->players[index];
+    simulation_init_player(player, PLAYER_ID(index, table->generations[index]));
+    player->active = true;
+    table->count++;
+    return player;
+}
+
+// Frees the slot and moves its generation on, so the removed ID no longer resolves.
+void player_table_remove(PlayerTable *table, int id) {
+    Player *player = player_table_get(table, id);
+    if (!player) {
+        return;
+    }
+    int index = PLAYER_INDEX(id);
+    player->active = false;
+    table->generations[index] = (Uint8)((table->generations[index] + 1) & PLAYER_GENERATION_MASK);
+    table->free_slots[table->free_count++] = index;
+    table->count--;
+}
+
+// Resolves an ID, which may come straight off the wire. Returns NULL for IDs out of range,
+// of a previous occupant of the slot, or of a removed player.
+Player *player_table_get(PlayerTable *table, int id) {
+    if (id < 0 || id > 0xFFFF) {
+        return NULL;
+    }
+    int index = PLAYER_INDEX(id);
+    if (index >= table->capacity || table->generations[index] != PLAYER_GENERATION(id)) {
+        return NULL;
+    }
+    Player *player = &table->players[index];
+    return player->active ? player : NULL;
+}
+
+// Clients keep the server's IDs: the slot takes on whatever ID the server announced, replacing
+// a previous occupant. Only for tables that never call player_table_add.
+Player *player_table_mirror(PlayerTable *table, int id) {
+    if (id < 0 || id > 0xFFFF || PLAYER_INDEX(id) >= table->capacity) {
+        return NULL;
+    }
+    Player *player = player_table_get(table, id);
+    if (player) {
+        return player;
+    }
+
+    int index = PLAYER_INDEX(id);
+    player = &table->players[index];
+    if (!player->active) {
+        table->count++;
+    }
+    table->generations[index] = (Uint8)PLAYER_GENERATION(id);
+    simulation_init_player(player, id);
+    player->active = true;
+    return player;
+}
+
+// Counterpart of player_table_mirror(): the player goes inactive and the slot waits for the next
+// ID the server announces in it. The free stack is left alone, mirrored tables do not use it.
+void player_table_unmirror(PlayerTable *table, int id) {
+    Player *player = player_table_get(table, id);
+    if (!player) {
+        return;
+    }
+    player->active = false;
+    table->count--;
+}
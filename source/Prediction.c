@@ -0,0 +1,59 @@
+#include "../include/Prediction.h"
+#include "../include/Simulation.h"
+
+#define PREDICTION_MASK (PREDICTION_HISTORY - 1)
+
+void prediction_init(Prediction *prediction) {
+    prediction->sequence = 0;
+    prediction->acked = 0;
+}
+
+// Moves the player right away and records the input for the server. Idle ticks are not recorded
+// unless earlier inputs are still unconfirmed, standing still needs no traffic.
+bool prediction_apply(Prediction *prediction, Player *player, Uint8 input, float dt) {
+    if (input == 0 && prediction->sequence == prediction->acked) {
+        return false;
+    }
+    if (prediction->sequence - prediction->acked >= PREDICTION_HISTORY) {
+        prediction->acked = prediction->sequence - PREDICTION_HISTORY + 1; // Server is far behind, oldest inputs are lost
+    }
+    prediction->sequence++;
+    prediction->inputs[prediction->sequence & PREDICTION_MASK] = input;
+    return simulation_move_player(player, input, dt);
+}
+
+// Fills in the newest unconfirmed inputs, returns false when there are none.
+bool prediction_pending(const Prediction *prediction, NetInput *message) {
+    Uint32 pending = prediction->sequence - prediction->acked;
+    if (pending == 0) {
+        return false;
+    }
+    message->count = (Uint8)SDL_min(pending, NET_MAX_INPUTS);
+    message->sequence = prediction->sequence;
+    for (int i = 0; i < message->count; i++) {
+        Uint32 sequence = prediction->sequence - message->count + 1 + i;
+        message->inputs[i] = prediction->inputs[sequence & PREDICTION_MASK];
+    }
+    return true;
+}
+
+// Restarts from the server's position after the acknowledged input and replays the inputs it has
+// not simulated yet. With matching simulations the result is where the player already was, and
+// the prediction is only corrected when it strayed further than the rounding on the wire.
+void prediction_reconcile(Prediction *prediction, Player *player, Uint32 acked, float x, float y, float dt) {
+    if ((Sint32)(acked - prediction->acked) < 0 || (Sint32)(prediction->sequence - acked) < 0) {
+        return; // Older than what we know, or not an input we sent
+    }
+    prediction->acked = acked;
+
+    Player replay = *player;
+    replay.x = x;
+    replay.y = y;
+    for (Uint32 sequence = acked + 1; (Sint32)(prediction->sequence - sequence) >= 0; sequence++) {
+        simulation_move_player(&replay, prediction->inputs[sequence & PREDICTION_MASK], dt);
+    }
+    if (SDL_fabsf(replay.x - player->x) > PREDICTION_TOLERANCE || SDL_fabsf(replay.y - player->y) > PREDICTION_TOLERANCE) {
+        player->x = replay.x;
+        player->y = replay.y;
+    }
+}
@@ -0,0 +1,483 @@
+#include "../include/Server.h"
+#include "../include/Spatial_Grid.h"
+#include "../include/Simulation.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static ServerRoom single_room; // Of server_start()
+
+bool server_room_init(ServerRoom *room, int lane, PlayerTable *table, int capacity, int tick_rate, const Player *host) {
+    SDL_zerop(room);
+    room->clients = (ClientSlot *)calloc(capacity, sizeof(ClientSlot));
+    room->player_clients = (int *)malloc(table->capacity * sizeof(int));
+    room->nearby = (int *)malloc(table->capacity * sizeof(int));
+    room->framed = (Uint8 *)calloc(table->capacity, sizeof(Uint8));
+    room->frames = (NetFrame *)malloc(capacity * NET_FRAME_HISTORY * sizeof(NetFrame));
+    room->sent_ticks = (Uint32 *)malloc((size_t)capacity * table->capacity * sizeof(Uint32));
+    room->candidates = (ServerCandidate *)malloc(table->capacity * sizeof(ServerCandidate));
+    if (!room->clients || !room->player_clients || !room->nearby || !room->framed || !room->frames ||
+        !room->sent_ticks || !room->candidates || !spatial_grid_init(&room->grid, table->capacity)) {
+        printf("Failed to allocate %d client slots\n", capacity);
+        server_room_destroy(room);
+        return false;
+    }
+    for (int i = 0; i < table->capacity; i++) {
+        room->player_clients[i] = -1;
+    }
+    for (int i = 0; i < capacity; i++) {
+        room->clients[i].frames = &room->frames[i * NET_FRAME_HISTORY];
+        room->clients[i].sent_ticks = &room->sent_ticks[(size_t)i * table->capacity];
+    }
+
+    room->lane = lane;
+    room->first_slot = lane * capacity;
+    room->players = table;
+    room->max_clients = capacity;
+    room->tick_rate = simulation_tick_rate(tick_rate); // What clients are told to predict at
+    room->host_id = host ? host->id : PLAYER_NONE;
+    room->tick_count = 0;
+    if (host) {
+        spatial_grid_update(&room->grid, PLAYER_INDEX(host->id), host->x, host->y);
+    }
+    return true;
+}
+
+void server_room_destroy(ServerRoom *room) {
+    spatial_grid_destroy(&room->grid);
+    free(room->clients);
+    free(room->player_clients);
+    free(room->nearby);
+    free(room->framed);
+    free(room->frames);
+    free(room->sent_ticks);
+    free(room->candidates);
+    room->clients = NULL;
+    room->player_clients = NULL;
+    room->nearby = NULL;
+    room->framed = NULL;
+    room->frames = NULL;
+    room->sent_ticks = NULL;
+    room->candidates = NULL;
+    room->max_clients = 0;
+}
+
+bool server_start(Uint16 port, PlayerTable *table, int capacity, int tick_rate, const Player *host) {
+    if (!server_room_init(&single_room, 0, table, capacity, tick_rate, host)) {
+        return false;
+    }
+    if (!network_start_server(port, capacity, 1)) {
+        server_stop();
+        return false;
+    }
+    printf("Server started on port %d for %d clients\n", port, capacity);
+    return true;
+}
+
+void server_stop(void) {
+    network_stop();
+    server_room_destroy(&single_room);
+}
+
+// Resolves a connection handle to its slot in O(1), NULL for stale handles
+static ClientSlot *server_client(ServerRoom *room, int connection) {
+    int index = NET_CONNECTION_INDEX(connection) - room->first_slot;
+    if (index < 0 || index >= room->max_clients || !room->clients[index].connected || room->clients[index].connection != connection) {
+        return NULL;
+    }
+    return &room->clients[index];
+}
+
+// Send to every client that finished joining, except one (-1 for none). The message is copied
+// once and every client's command refers to that copy.
+static void server_send_to_active(ServerRoom *room, NetChannel channel, const Uint8 *buffer, int size, int except) {
+    NetSharedBuffer *shared = network_shared_create(buffer, size);
+    for (int i = 0; i < room->max_clients; i++) {
+        ClientSlot *client = &room->clients[i];
+        if (!client->connected || client->join_state != NET_JOIN_ACTIVE || client->connection == except) {
+            continue;
+        }
+        if (shared) {
+            network_lane_send_shared(room->lane, client->connection, channel, shared);
+        } else {
+            network_lane_send(room->lane, client->connection, channel, buffer, size);
+        }
+    }
+    network_shared_release(shared);
+}
+
+static bool server_in_view(const Player *viewer, const Player *subject) {
+    return SDL_fabsf(viewer->x - subject->x) <= AOI_VIEW_HALF_WIDTH && SDL_fabsf(viewer->y - subject->y) <= AOI_VIEW_HALF_HEIGHT;
+}
+
+static float server_priority(const ServerRoom *room, const ClientSlot *client, const Player *viewer, int slot, bool in_view) {
+    float ticks = (float)(room->tick_count - client->sent_ticks[slot]);
+    if (!in_view) {
+        return ticks * SERVER_PRIORITY_FAR;
+    }
+    const Player *subject = &room->players->players[slot];
+    float distance = SDL_max(SDL_fabsf(viewer->x - subject->x) / AOI_VIEW_HALF_WIDTH, SDL_fabsf(viewer->y - subject->y) / AOI_VIEW_HALF_HEIGHT);
+    return ticks * (SERVER_PRIORITY_VIEW + SERVER_PRIORITY_NEAR * (1.0f - SDL_min(distance, 1.0f)));
+}
+
+static int server_compare_priority(const void *a, const void *b) {
+    float pa = ((const ServerCandidate *)a)->priority, pb = ((const ServerCandidate *)b)->priority;
+    return (pa < pb) - (pa > pb);
+}
+
+// Players in view the client is not sent this tick stay in its frame as last sent, which only
+// costs their difference to the baseline; that and players leaving the view are paid first.
+// Returns the bits spent that way.
+static int server_gather_candidates(ServerRoom *room, ClientSlot *client, const Player *viewer, const NetFrame *baseline, int *count) {
+    const NetFrame *previous = net_frame_history_find(client->frames, room->tick_count - 1);
+    int spent = 0;
+    *count = 0;
+    int framed = 0;
+    int nearby = spatial_grid_query(&room->grid, viewer->x, viewer->y, AOI_VIEW_HALF_WIDTH, AOI_VIEW_HALF_HEIGHT, room->nearby, room->players->capacity);
+    for (int i = 0; i < nearby && framed < NET_MAX_FRAME_PLAYERS; i++) {
+        int slot = room->nearby[i];
+        const Player *subject = &room->players->players[slot];
+        if (subject == viewer || !server_in_view(viewer, subject)) {
+            continue;
+        }
+        ServerCandidate *candidate = &room->candidates[(*count)++];
+        candidate->slot = slot;
+        candidate->in_view = true;
+        candidate->priority = server_priority(room, client, viewer, slot, true);
+        net_player_state(&candidate->state, subject);
+        const NetPlayerState *base = baseline ? net_frame_find(baseline, candidate->state.id) : NULL;
+        candidate->held = previous ? net_frame_find(previous, candidate->state.id) : base;
+        int held_cost = candidate->held ? net_snapshot_entry_bits(base, candidate->held) : (base ? net_snapshot_entry_bits(base, NULL) : 0);
+        candidate->cost = net_snapshot_entry_bits(base, &candidate->state) - held_cost;
+        spent += held_cost;
+        room->framed[slot] = 1;
+        framed++;
+    }
+    for (int i = 0; baseline && i < baseline->count; i++) {
+        if (!room->framed[PLAYER_INDEX(baseline->players[i].id)]) {
+            spent += net_snapshot_entry_bits(&baseline->players[i], NULL);
+        }
+    }
+
+    // Far players are staggered by slot so only a few compete per tick
+    for (int i = (int)(AOI_TRICKLE_TICKS - room->tick_count % AOI_TRICKLE_TICKS) % AOI_TRICKLE_TICKS;
+         i < room->players->capacity; i += AOI_TRICKLE_TICKS) {
+        const Player *subject = &room->players->players[i];
+        if (!subject->active || subject == viewer || room->framed[i]) {
+            continue;
+        }
+        ServerCandidate *candidate = &room->candidates[(*count)++];
+        candidate->slot = i;
+        candidate->in_view = false;
+        candidate->priority = server_priority(room, client, viewer, i, false);
+        candidate->cost = NET_PLAYER_STATE_BITS;
+        candidate->held = NULL;
+        net_player_state(&candidate->state, subject);
+    }
+    return spent;
+}
+
+// One snapshot per client per tick. The frame holds the players in view and goes out as
+// changes against the newest frame the client acknowledged, so players that stood still cost
+// nothing and a lost snapshot is repaired by the next one. Far players, and those that did
+// not fit the frame, are sent in full when they win their trickle turn. What goes in is
+// picked by priority within SERVER_SNAPSHOT_BUDGET.
+static void server_send_snapshot(ServerRoom *room, ClientSlot *client) {
+    const Player *viewer = player_table_get(room->players, client->player_id);
+    if (!viewer) {
+        return;
+    }
+
+    // Baselines older than the history have been overwritten, the client then gets the frame in full
+    const NetFrame *baseline = NULL;
+    if (room->tick_count - client->acked_tick < NET_FRAME_HISTORY) {
+        baseline = net_frame_history_find(client->frames, client->acked_tick);
+    }
+
+    int count;
+    int budget = SERVER_SNAPSHOT_BUDGET * 8 - NET_SNAPSHOT_OVERHEAD_BITS - server_gather_candidates(room, client, viewer, baseline, &count);
+    qsort(room->candidates, count, sizeof(ServerCandidate), server_compare_priority);
+
+    NetMessage message;
+    NetSnapshot *snapshot = &message.data.snapshot;
+    NetFrame *frame = &client->frames[NET_FRAME_SLOT(room->tick_count)];
+    frame->tick = room->tick_count;
+    frame->count = 0;
+    snapshot->far_count = 0;
+    for (int i = 0; i < count; i++) {
+        ServerCandidate *candidate = &room->candidates[i];
+        bool picked = candidate->cost <= budget && (candidate->in_view || snapshot->far_count < NET_MAX_FAR_PLAYERS);
+        if (picked) {
+            budget -= candidate->cost;
+            client->sent_ticks[candidate->slot] = room->tick_count;
+        }
+        if (candidate->in_view) {
+            if (picked || candidate->held) {
+                frame->players[frame->count++] = picked ? candidate->state : *candidate->held;
+            }
+            room->framed[candidate->slot] = 0;
+        } else if (picked) {
+            snapshot->far[snapshot->far_count++] = candidate->state;
+        }
+    }
+    net_frame_sort(frame);
+
+    net_snapshot_diff(baseline, frame, snapshot);
+    snapshot->input_ack = client->input_processed;
+    snapshot->self_x = (Sint16)SDL_lroundf(viewer->x);
+    snapshot->self_y = (Sint16)SDL_lroundf(viewer->y);
+
+    Uint8 buffer[NET_MAX_MESSAGE_SIZE];
+    int size = net_encode(NET_MSG_SNAPSHOT, &message, buffer);
+    if (size >= 0) {
+        network_lane_send(room->lane, client->connection, NET_CHANNEL_UNRELIABLE, buffer, size);
+    }
+}
+
+// Acks arrive unordered over the unreliable channel; only newer ones for frames still kept count
+static void server_handle_ack(ServerRoom *room, ClientSlot *client, Uint32 tick) {
+    if (room->tick_count - tick > NET_FRAME_HISTORY || !net_frame_history_find(client->frames, tick)) {
+        return;
+    }
+    if (client->acked_tick == NET_NO_BASELINE || (Sint32)(tick - client->acked_tick) > 0) {
+        client->acked_tick = tick;
+    }
+}
+
+// Inputs come with the ones before them repeated, only those not seen yet are queued. If the
+// client got more than the queue ahead, the oldest are dropped.
+static void server_queue_inputs(ClientSlot *client, const NetInput *input) {
+    for (int i = 0; i < input->count; i++) {
+        Uint32 sequence = input->sequence - input->count + 1 + i;
+        if ((Sint32)(sequence - client->input_received) <= 0) {
+            continue;
+        }
+        client->inputs[sequence & (SERVER_INPUT_QUEUE - 1)] = input->inputs[i] & (INPUT_UP | INPUT_DOWN | INPUT_LEFT | INPUT_RIGHT);
+        client->input_received = sequence;
+        if (sequence - client->input_processed > SERVER_INPUT_QUEUE) {
+            client->input_processed = sequence - SERVER_INPUT_QUEUE;
+        }
+    }
+}
+
+// The server is the authority on positions: it runs the same movement the client predicted
+static void server_simulate_client(ServerRoom *room, ClientSlot *client, float dt) {
+    Player *player = player_table_get(room->players, client->player_id);
+    if (!player) {
+        return;
+    }
+    int steps = client->input_received - client->input_processed > SERVER_INPUT_BACKLOG ? 2 : 1;
+    for (int i = 0; i < steps && client->input_processed != client->input_received; i++) {
+        client->input_processed++;
+        simulation_move_player(player, client->inputs[client->input_processed & (SERVER_INPUT_QUEUE - 1)], dt);
+    }
+    spatial_grid_update(&room->grid, PLAYER_INDEX(player->id), player->x, player->y);
+}
+
+static void server_handle_message(ServerRoom *room, int connection, const NetMessage *message) {
+    ClientSlot *client = server_client(room, connection);
+    if (!client) {
+        return;
+    }
+    if (message->header.type == NET_MSG_ACK) {
+        server_handle_ack(room, client, message->data.ack);
+        return;
+    }
+
+    if (message->header.type == NET_MSG_INPUT) {
+        server_queue_inputs(client, &message->data.input);
+    }
+}
+
+// A new connection gets a player from the table, the handshake itself runs in server_advance_join()
+static void server_connect_client(ServerRoom *room, int connection, Uint32 token) {
+    int index = NET_CONNECTION_INDEX(connection) - room->first_slot;
+    Player *player = index >= 0 && index < room->max_clients ? player_table_add(room->players) : NULL;
+    if (!player) {
+        printf("No room for another player, dropping connection\n");
+        network_lane_disconnect(room->lane, connection);
+        return;
+    }
+
+    ClientSlot *client = &room->clients[index];
+    client->connection = connection;
+    client->player_id = player->id;
+    client->join_state = NET_JOIN_ASSIGN_ID;
+    client->token = token;
+    client->connected = true;
+    client->acked_tick = NET_NO_BASELINE;
+    client->input_received = 0;
+    client->input_processed = 0;
+    net_frame_history_clear(client->frames);
+    for (int i = 0; i < room->players->capacity; i++) {
+        client->sent_ticks[i] = room->tick_count;
+    }
+    room->player_clients[PLAYER_INDEX(player->id)] = index;
+    spatial_grid_update(&room->grid, PLAYER_INDEX(player->id), player->x, player->y);
+}
+
+// The client's player stops being simulated and its ID stops resolving
+static void server_disconnect_client(ServerRoom *room, int connection) {
+    ClientSlot *client = server_client(room, connection);
+    if (!client) {
+        return;
+    }
+    client->connected = false;
+    room->player_clients[PLAYER_INDEX(client->player_id)] = -1;
+    spatial_grid_remove(&room->grid, PLAYER_INDEX(client->player_id));
+    player_table_remove(room->players, client->player_id);
+
+    // Everyone else drops the player now instead of waiting for it to fall out of their frames
+    NetMessage message;
+    Uint8 buffer[NET_MAX_MESSAGE_SIZE];
+    message.data.leave = (Uint16)client->player_id;
+    int size = net_encode(NET_MSG_LEAVE, &message, buffer);
+    if (size >= 0) {
+        server_send_to_active(room, NET_CHANNEL_RELIABLE, buffer, size, -1);
+    }
+    printf("Client %d disconnected\n", client->player_id);
+}
+
+// Every other active player, split over as many WORLD messages as it takes
+static void server_send_world(ServerRoom *room, const ClientSlot *client) {
+    NetMessage message;
+    Uint8 buffer[NET_MAX_MESSAGE_SIZE];
+    int size;
+
+    message.data.world.count = 0;
+    for (int i = 0; i < room->players->capacity; i++) {
+        const Player *player = &room->players->players[i];
+        if (!player->active || player->id == client->player_id) {
+            continue;
+        }
+        net_player_state(&message.data.world.players[message.data.world.count++], player);
+        if (message.data.world.count == NET_MAX_WORLD_PLAYERS) {
+            size = net_encode(NET_MSG_WORLD, &message, buffer);
+            if (size >= 0) {
+                network_lane_send(room->lane, client->connection, NET_CHANNEL_RELIABLE, buffer, size);
+            }
+            message.data.world.count = 0;
+        }
+    }
+    // Always sent, even when empty, the final WORLD is what completes the client's join
+    size = net_encode(NET_MSG_WORLD, &message, buffer);
+    if (size >= 0) {
+        network_lane_send(room->lane, client->connection, NET_CHANNEL_RELIABLE, buffer, size);
+    }
+}
+
+// Move a joining client one step through the handshake without blocking the tick
+static void server_advance_join(ServerRoom *room, ClientSlot *client) {
+    NetMessage message;
+    Uint8 buffer[NET_MAX_MESSAGE_SIZE];
+    int size;
+
+    switch (client->join_state) {
+    case NET_JOIN_ASSIGN_ID:
+        message.data.binding.id = (Uint16)client->player_id;
+        message.data.binding.token = client->token;
+        message.data.binding.tick_rate = (Uint16)room->tick_rate;
+        message.data.binding.connection = (Uint32)client->connection;
+        size = net_encode(NET_MSG_ID, &message, buffer);
+        if (size >= 0) {
+            network_lane_send(room->lane, client->connection, NET_CHANNEL_RELIABLE, buffer, size);
+        }
+        client->join_state = NET_JOIN_SEND_WORLD;
+        break;
+    case NET_JOIN_SEND_WORLD:
+        server_send_world(room, client);
+
+        // Notify all existing clients of the new player
+        net_player_state(&message.data.player, player_table_get(room->players, client->player_id));
+        size = net_encode(NET_MSG_SYNC, &message, buffer);
+        if (size >= 0) {
+            server_send_to_active(room, NET_CHANNEL_RELIABLE, buffer, size, client->connection);
+        }
+
+        client->join_state = NET_JOIN_ACTIVE;
+        printf("Client connected with ID %d\n", client->player_id);
+        break;
+    case NET_JOIN_ACTIVE:
+        break;
+    }
+}
+
+// Handles everything the network thread handed over and moves joining clients along.
+void server_room_update(ServerRoom *room) {
+    const NetEvent *event;
+    while ((event = network_lane_peek_event(room->lane)) != NULL) {
+        switch (event->type) {
+        case NET_EVENT_CONNECTED:
+            server_connect_client(room, event->connection, event->token);
+            break;
+        case NET_EVENT_DISCONNECTED:
+            server_disconnect_client(room, event->connection);
+            break;
+        case NET_EVENT_MESSAGE:
+            server_handle_message(room, event->connection, &event->message);
+            break;
+        }
+        network_lane_pop_event(room->lane);
+    }
+
+    for (int i = 0; i < room->max_clients; i++) {
+        if (room->clients[i].connected && room->clients[i].join_state != NET_JOIN_ACTIVE) {
+            server_advance_join(room, &room->clients[i]);
+        }
+    }
+}
+
+// Runs after the host's own movement: clients' inputs are simulated, then every client gets its snapshot.
+void server_room_tick(ServerRoom *room, float dt) {
+    Player *host = player_table_get(room->players, room->host_id);
+    if (host) {
+        spatial_grid_update(&room->grid, PLAYER_INDEX(host->id), host->x, host->y);
+    }
+    for (int i = 0; i < room->max_clients; i++) {
+        if (room->clients[i].connected && room->clients[i].join_state == NET_JOIN_ACTIVE) {
+            server_simulate_client(room, &room->clients[i], dt);
+        }
+    }
+
+    for (int i = 0; i < room->max_clients; i++) {
+        if (room->clients[i].connected && room->clients[i].join_state == NET_JOIN_ACTIVE) {
+            server_send_snapshot(room, &room->clients[i]);
+        }
+    }
+    room->tick_count++;
+}
+
+// One line per client from the network thread's latest statistics, plus the totals.
+void server_room_print_stats(const ServerRoom *room) {
+    NetStats total;
+    SDL_zero(total);
+    int count = 0;
+    for (int i = 0; i < room->max_clients; i++) {
+        NetStats stats;
+        if (!room->clients[i].connected || !network_get_stats(room->clients[i].connection, &stats)) {
+            continue;
+        }
+        printf("  Client %d: rtt %.1f ms, in %.1f kbit/s %.0f msg/s, out %.1f kbit/s %.0f msg/s, queued %d B, drops %u\n",
+               room->clients[i].player_id, stats.rtt_ms, stats.kbps_in, stats.messages_in_rate,
+               stats.kbps_out, stats.messages_out_rate, stats.send_queue, stats.drops);
+        total.kbps_in += stats.kbps_in;
+        total.kbps_out += stats.kbps_out;
+        total.messages_in_rate += stats.messages_in_rate;
+        total.messages_out_rate += stats.messages_out_rate;
+        total.drops += stats.drops;
+        count++;
+    }
+    printf("Network: %d clients, in %.1f kbit/s %.0f msg/s, out %.1f kbit/s %.0f msg/s, drops %u\n",
+           count, total.kbps_in, total.messages_in_rate, total.kbps_out, total.messages_out_rate, total.drops);
+}
+
+void server_update(void) {
+    server_room_update(&single_room);
+}
+
+void server_tick(float dt) {
+    server_room_tick(&single_room, dt);
+}
+
+void server_print_stats(void) {
+    server_room_print_stats(&single_room);
+}
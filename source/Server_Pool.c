@@ -0,0 +1,147 @@
+#include "../include/Server_Pool.h"
+#include "../include/Simulation.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct ServerWorker {
+    SDL_Thread *thread;
+    int index;
+    ServerWorkerReport report; // Under report_lock, taken and reset by the main thread
+} ServerWorker;
+
+static ServerRoom *rooms = NULL;
+static PlayerTable *tables = NULL; // One per room
+static int room_count = 0;         // Rooms set up so far
+static ServerWorker *workers = NULL;
+static int worker_count = 0;
+static int pool_tick_rate = TICK_RATE;
+static SDL_atomic_t pool_running;
+static SDL_SpinLock report_lock = 0;
+
+// The same loop as a single-room server, over every room pinned to this worker
+static int server_worker_run(void *data) {
+    ServerWorker *worker = (ServerWorker *)data;
+    SimulationClock clock;
+    simulation_clock_init(&clock, pool_tick_rate);
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    while (SDL_AtomicGet(&pool_running)) {
+        int ticks = simulation_clock_advance(&clock);
+        Uint64 work_start = SDL_GetPerformanceCounter();
+        int players = 0;
+        for (int r = worker->index; r < room_count; r += worker_count) {
+            ServerRoom *room = &rooms[r];
+            server_room_update(room);
+            for (int i = 0; i < ticks; i++) {
+                simulation_begin_tick(room->players->players, room->players->capacity);
+                server_room_tick(room, (float)clock.tick_seconds);
+            }
+            players += room->players->count;
+        }
+
+        if (ticks > 0) {
+            double work = (SDL_GetPerformanceCounter() - work_start) / frequency;
+            SDL_AtomicLock(&report_lock);
+            ServerWorkerReport *report = &worker->report;
+            report->players = players;
+            report->ticks += ticks;
+            report->overruns += work > clock.tick_seconds;
+            report->work_total += work;
+            report->work_max = SDL_max(report->work_max, work);
+            report->work_count++;
+            SDL_AtomicUnlock(&report_lock);
+        }
+
+        double remaining = clock.tick_seconds - clock.accumulator;
+        if (remaining > 0.001) {
+            SDL_Delay((Uint32)(remaining * 1000.0));
+        }
+    }
+    return 0;
+}
+
+// Rooms get one network lane each and take players_per_room connections, new ones fill the
+// lowest room with space.
+bool server_pool_start(Uint16 port, int count, int players_per_room, int worker_total, int tick_rate) {
+    count = SDL_clamp(count, 1, SERVER_POOL_MAX_ROOMS);
+    worker_total = SDL_clamp(worker_total, 1, count);
+    players_per_room = SDL_clamp(players_per_room, 1, PLAYER_TABLE_MAX);
+    if (count * players_per_room > 0x10000) {
+        printf("%d rooms of %d clients are more connections than handles can address\n", count, players_per_room);
+        return false;
+    }
+    rooms = (ServerRoom *)calloc(count, sizeof(ServerRoom));
+    tables = (PlayerTable *)calloc(count, sizeof(PlayerTable));
+    workers = (ServerWorker *)calloc(worker_total, sizeof(ServerWorker));
+    if (!rooms || !tables || !workers) {
+        printf("Failed to allocate %d rooms\n", count);
+        server_pool_stop();
+        return false;
+    }
+    for (int r = 0; r < count; r++) {
+        if (!player_table_init(&tables[r], players_per_room) ||
+            !server_room_init(&rooms[r], r, &tables[r], players_per_room, tick_rate, NULL)) {
+            player_table_destroy(&tables[r]);
+            server_pool_stop();
+            return false;
+        }
+        room_count++;
+    }
+    if (!network_start_server(port, players_per_room, count)) {
+        server_pool_stop();
+        return false;
+    }
+
+    pool_tick_rate = tick_rate;
+    worker_count = worker_total;
+    SDL_AtomicSet(&pool_running, 1);
+    for (int w = 0; w < worker_total; w++) {
+        char name[32];
+        SDL_snprintf(name, sizeof(name), "room worker %d", w);
+        workers[w].index = w;
+        workers[w].thread = SDL_CreateThread(server_worker_run, name, &workers[w]);
+        if (!workers[w].thread) {
+            printf("SDL_CreateThread: %s\n", SDL_GetError());
+            server_pool_stop();
+            return false;
+        }
+    }
+    printf("Server started on port %d for %d rooms of %d clients on %d workers\n",
+           port, count, players_per_room, worker_total);
+    return true;
+}
+
+void server_pool_stop(void) {
+    SDL_AtomicSet(&pool_running, 0);
+    for (int w = 0; w < worker_count; w++) {
+        if (workers[w].thread) {
+            SDL_WaitThread(workers[w].thread, NULL);
+        }
+    }
+    network_stop();
+    for (int r = 0; r < room_count; r++) {
+        server_room_destroy(&rooms[r]);
+        player_table_destroy(&tables[r]);
+    }
+    free(rooms);
+    free(tables);
+    free(workers);
+    rooms = NULL;
+    tables = NULL;
+    workers = NULL;
+    room_count = 0;
+    worker_count = 0;
+}
+
+int server_pool_workers(void) {
+    return worker_count;
+}
+
+// Copies what the worker did since the last call and starts over.
+void server_pool_take_report(int worker, ServerWorkerReport *report) {
+    SDL_AtomicLock(&report_lock);
+    *report = workers[worker].report;
+    SDL_zero(workers[worker].report);
+    workers[worker].report.players = report->players;
+    SDL_AtomicUnlock(&report_lock);
+    report->rooms = (room_count - worker + worker_count - 1) / worker_count;
+}
@@ -0,0 +1,81 @@
+#include "../include/Simulation.h"
+
+// The rate a clock asked for tick_rate runs at, the default for none.
+int simulation_tick_rate(int tick_rate) {
+    return tick_rate <= 0 ? TICK_RATE : SDL_clamp(tick_rate, TICK_RATE_MIN, TICK_RATE_MAX);
+}
+
+void simulation_clock_init(SimulationClock *clock, int tick_rate) {
+    clock->tick_rate = simulation_tick_rate(tick_rate);
+    clock->tick_seconds = 1.0 / clock->tick_rate;
+    clock->accumulator = 0.0;
+    clock->last_counter = SDL_GetPerformanceCounter();
+    clock->tick = 0;
+}
+
+// Returns how many ticks are due since the last call. Long stalls are capped so a hitch
+// does not turn into a burst of catch-up ticks.
+int simulation_clock_advance(SimulationClock *clock) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    double elapsed = (double)(now - clock->last_counter) / (double)SDL_GetPerformanceFrequency();
+    clock->last_counter = now;
+    clock->accumulator += SDL_min(elapsed, MAX_FRAME_SECONDS);
+
+    int ticks = 0;
+    while (clock->accumulator >= clock->tick_seconds) {
+        clock->accumulator -= clock->tick_seconds;
+        clock->tick++;
+        ticks++;
+    }
+    return ticks;
+}
+
+float simulation_clock_alpha(const SimulationClock *clock) {
+    return (float)(clock->accumulator / clock->tick_seconds);
+}
+
+// Puts an inactive player at the spawn point.
+void simulation_init_player(Player *player, int id) {
+    player->id = id;
+    player->rect.w = 32;
+    player->rect.h = 32;
+    player->x = player->prev_x = WINDOW_WIDTH / 2 - player->rect.w / 2;
+    player->y = player->prev_y = WINDOW_HEIGHT / 2 - player->rect.h / 2;
+    player->rect.x = (int)player->x;
+    player->rect.y = (int)player->y;
+    player->active = false;
+}
+
+// Remember where everyone was so rendering can blend towards the new tick.
+void simulation_begin_tick(Player *players, int count) {
+    for (int i = 0; i < count; i++) {
+        players[i].prev_x = players[i].x;
+        players[i].prev_y = players[i].y;
+    }
+}
+
+// Moves the player for one tick of input, diagonals are normalized and the player stays on the map.
+// Returns whether the position changed.
+bool simulation_move_player(Player *player, Uint8 input, float dt) {
+    float dx = 0.0f, dy = 0.0f;
+    if (input & INPUT_UP) dy -= 1.0f;
+    if (input & INPUT_DOWN) dy += 1.0f;
+    if (input & INPUT_LEFT) dx -= 1.0f;
+    if (input & INPUT_RIGHT) dx += 1.0f;
+    if (dx == 0.0f && dy == 0.0f) {
+        return false;
+    }
+    if (dx != 0.0f && dy != 0.0f) {
+        dx *= 0.7071f;
+        dy *= 0.7071f;
+    }
+
+    float old_x = player->x, old_y = player->y;
+    player->x = SDL_clamp(player->x + dx * PLAYER_SPEED * dt, 0.0f, (float)(MAP_PIXEL_WIDTH - player->rect.w));
+    player->y = SDL_clamp(player->y + dy * PLAYER_SPEED * dt, 0.0f, (float)(MAP_PIXEL_HEIGHT - player->rect.h));
+    return player->x != old_x || player->y != old_y;
+}
+
+float simulation_lerp(float from, float to, float alpha) {
+    return from + (to - from) * alpha;
+}
@@ -0,0 +1,95 @@
+#include "../include/Spatial_Grid.h"
+#include <stdlib.h>
+
+// Positions off the map (clients are not trusted) land in the nearest edge cell
+static int spatial_cell_x(float x) {
+    return SDL_clamp((int)(x / SPATIAL_CELL_SIZE), 0, SPATIAL_GRID_WIDTH - 1);
+}
+
+static int spatial_cell_y(float y) {
+    return SDL_clamp((int)(y / SPATIAL_CELL_SIZE), 0, SPATIAL_GRID_HEIGHT - 1);
+}
+
+bool spatial_grid_init(SpatialGrid *grid, int capacity) {
+    grid->next = (int *)malloc(capacity * sizeof(int));
+    grid->prev = (int *)malloc(capacity * sizeof(int));
+    grid->cells = (int *)malloc(capacity * sizeof(int));
+    if (!grid->next || !grid->prev || !grid->cells) {
+        spatial_grid_destroy(grid);
+        return false;
+    }
+
+    for (int y = 0; y < SPATIAL_GRID_HEIGHT; y++) {
+        for (int x = 0; x < SPATIAL_GRID_WIDTH; x++) {
+            grid->heads[y][x] = -1;
+        }
+    }
+    for (int i = 0; i < capacity; i++) {
+        grid->cells[i] = -1;
+    }
+    grid->capacity = capacity;
+    return true;
+}
+
+void spatial_grid_destroy(SpatialGrid *grid) {
+    free(grid->next);
+    free(grid->prev);
+    free(grid->cells);
+    grid->next = NULL;
+    grid->prev = NULL;
+    grid->cells = NULL;
+    grid->capacity = 0;
+}
+
+void spatial_grid_remove(SpatialGrid *grid, int entity) {
+    int cell = grid->cells[entity];
+    if (cell < 0) {
+        return;
+    }
+
+    int *head = &grid->heads[cell / SPATIAL_GRID_WIDTH][cell % SPATIAL_GRID_WIDTH];
+    if (grid->prev[entity] >= 0) {
+        grid->next[grid->prev[entity]] = grid->next[entity];
+    } else {
+        *head = grid->next[entity];
+    }
+    if (grid->next[entity] >= 0) {
+        grid->prev[grid->next[entity]] = grid->prev[entity];
+    }
+    grid->cells[entity] = -1;
+}
+
+// Inserts the entity or moves it to the cell of its new position; a no-op within the same cell.
+void spatial_grid_update(SpatialGrid *grid, int entity, float x, float y) {
+    int cell = spatial_cell_y(y) * SPATIAL_GRID_WIDTH + spatial_cell_x(x);
+    if (grid->cells[entity] == cell) {
+        return;
+    }
+    spatial_grid_remove(grid, entity);
+
+    int *head = &grid->heads[cell / SPATIAL_GRID_WIDTH][cell % SPATIAL_GRID_WIDTH];
+    grid->prev[entity] = -1;
+    grid->next[entity] = *head;
+    if (*head >= 0) {
+        grid->prev[*head] = entity;
+    }
+    *head = entity;
+    grid->cells[entity] = cell;
+}
+
+// Collects the entities of every cell the rectangle touches, which is a superset of those
+// inside it; callers that need an exact test check positions themselves. Returns the count.
+int spatial_grid_query(const SpatialGrid *grid, float x, float y, float half_width, float half_height, int *entities, int max_entities) {
+    int min_x = spatial_cell_x(x - half_width), max_x = spatial_cell_x(x + half_width);
+    int min_y = spatial_cell_y(y - half_height), max_y = spatial_cell_y(y + half_height);
+    int count = 0;
+
+    for (int cy = min_y; cy <= max_y; cy++) {
+        for (int cx = min_x; cx <= max_x; cx++) {
+            for (int entity = grid->heads[cy][cx]; entity >= 0 && count < max_entities; entity = grid->next[entity]) {
+                entities[count++] = entity;
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,127 @@
+#include "../include/Terrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+Terrain *terrain_create(SDL_Renderer *renderer, SDL_Texture *tile_texture) {
+    Terrain *terrain = (Terrain *)calloc(1, sizeof(Terrain));
+    if (!terrain) {
+        return NULL;
+    }
+    terrain->tile_texture = tile_texture;
+
+    for (int y = 0; y < MAP_HEIGHT; y++) {
+        for (int x = 0; x < MAP_WIDTH; x++) {
+            SDL_Color tint = { 255, (Uint8)(x * y), (Uint8)(x - y), 255 };
+            terrain->tiles[y][x] = tint;
+        }
+    }
+
+    for (int cy = 0; cy < TERRAIN_CHUNKS_Y; cy++) {
+        for (int cx = 0; cx < TERRAIN_CHUNKS_X; cx++) {
+            TerrainChunk *chunk = &terrain->chunks[cy][cx];
+            int tiles_w = SDL_min(TERRAIN_CHUNK_TILES, MAP_WIDTH - cx * TERRAIN_CHUNK_TILES);
+            int tiles_h = SDL_min(TERRAIN_CHUNK_TILES, MAP_HEIGHT - cy * TERRAIN_CHUNK_TILES);
+
+            chunk->rect.x = cx * TERRAIN_CHUNK_TILES * TILE_RENDER_SIZE;
+            chunk->rect.y = cy * TERRAIN_CHUNK_TILES * TILE_RENDER_SIZE;
+            chunk->rect.w = tiles_w * TILE_RENDER_SIZE;
+            chunk->rect.h = tiles_h * TILE_RENDER_SIZE;
+            chunk->dirty = true;
+            chunk->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, chunk->rect.w, chunk->rect.h);
+            if (!chunk->texture) {
+                printf("Failed to create terrain chunk texture: %s\n", SDL_GetError());
+                terrain_destroy(terrain);
+                return NULL;
+            }
+            SDL_SetTextureBlendMode(chunk->texture, SDL_BLENDMODE_BLEND);
+        }
+    }
+
+    return terrain;
+}
+
+void terrain_destroy(Terrain *terrain) {
+    if (!terrain) {
+        return;
+    }
+    for (int cy = 0; cy < TERRAIN_CHUNKS_Y; cy++) {
+        for (int cx = 0; cx < TERRAIN_CHUNKS_X; cx++) {
+            if (terrain->chunks[cy][cx].texture) {
+                SDL_DestroyTexture(terrain->chunks[cy][cx].texture);
+            }
+        }
+    }
+    free(terrain);
+}
+
+void terrain_set_tile(Terrain *terrain, int x, int y, SDL_Color tint) {
+    if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) {
+        return;
+    }
+    terrain->tiles[y][x] = tint;
+    terrain->chunks[y / TERRAIN_CHUNK_TILES][x / TERRAIN_CHUNK_TILES].dirty = true;
+}
+
+// Render target contents are lost on device/target resets, so everything has to be re-baked.
+void terrain_invalidate(Terrain *terrain) {
+    for (int cy = 0; cy < TERRAIN_CHUNKS_Y; cy++) {
+        for (int cx = 0; cx < TERRAIN_CHUNKS_X; cx++) {
+            terrain->chunks[cy][cx].dirty = true;
+        }
+    }
+}
+
+static void terrain_bake_chunk(Terrain *terrain, SDL_Renderer *renderer, int cx, int cy) {
+    TerrainChunk *chunk = &terrain->chunks[cy][cx];
+    SDL_Texture *previous_target = SDL_GetRenderTarget(renderer);
+
+    SDL_SetRenderTarget(renderer, chunk->texture);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+
+    SDL_Rect tile_rect = { 0, 0, TILE_RENDER_SIZE, TILE_RENDER_SIZE };
+    int first_x = cx * TERRAIN_CHUNK_TILES;
+    int first_y = cy * TERRAIN_CHUNK_TILES;
+    int tiles_w = chunk->rect.w / TILE_RENDER_SIZE;
+    int tiles_h = chunk->rect.h / TILE_RENDER_SIZE;
+
+    for (int y = 0; y < tiles_h; y++) {
+        for (int x = 0; x < tiles_w; x++) {
+            SDL_Color tint = terrain->tiles[first_y + y][first_x + x];
+            SDL_SetTextureColorMod(terrain->tile_texture, tint.r, tint.g, tint.b);
+            tile_rect.x = x * TILE_RENDER_SIZE;
+            tile_rect.y = y * TILE_RENDER_SIZE;
+            SDL_RenderCopy(renderer, terrain->tile_texture, NULL, &tile_rect);
+        }
+    }
+
+    SDL_SetTextureColorMod(terrain->tile_texture, 255, 255, 255);
+    SDL_SetRenderTarget(renderer, previous_target);
+    chunk->dirty = false;
+}
+
+// Only chunks overlapping the view are baked and copied, clipped to the visible part.
+void terrain_draw(Terrain *terrain, SDL_Renderer *renderer, const SDL_Rect *view) {
+    const int chunk_size = TERRAIN_CHUNK_TILES * TILE_RENDER_SIZE;
+    int first_cx = SDL_max(view->x / chunk_size, 0);
+    int first_cy = SDL_max(view->y / chunk_size, 0);
+    int last_cx = SDL_min((view->x + view->w - 1) / chunk_size, TERRAIN_CHUNKS_X - 1);
+    int last_cy = SDL_min((view->y + view->h - 1) / chunk_size, TERRAIN_CHUNKS_Y - 1);
+
+    for (int cy = first_cy; cy <= last_cy; cy++) {
+        for (int cx = first_cx; cx <= last_cx; cx++) {
+            TerrainChunk *chunk = &terrain->chunks[cy][cx];
+            SDL_Rect visible;
+            if (!SDL_IntersectRect(&chunk->rect, view, &visible)) {
+                continue;
+            }
+            if (chunk->dirty) {
+                terrain_bake_chunk(terrain, renderer, cx, cy);
+            }
+
+            SDL_Rect src_rect = { visible.x - chunk->rect.x, visible.y - chunk->rect.y, visible.w, visible.h };
+            SDL_Rect dst_rect = { visible.x - view->x, visible.y - view->y, visible.w, visible.h };
+            SDL_RenderCopy(renderer, chunk->texture, &src_rect, &dst_rect);
+        }
+    }
+}
@@ -0,0 +1,422 @@
+#include "../../SDL2/include/SDL.h"
+#include "../../SDL2/include/SDL_net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "../../include/Game_Config.h"
+#include "../../include/Net_Protocol.h"
+#include "../../include/Net_Connection.h"
+#include "../../include/Net_Snapshot.h"
+#include "../../include/Simulation.h"
+#include "../../include/Player_Table.h"
+#include "../../include/Prediction.h"
+#include "../../include/Net_Conditioner.h"
+
+// Headless load generator: N bot clients join a server through the real protocol, walk around
+// at random and measure how long their moves take to reach the other bots' snapshots. Bots
+// predict their movement from the inputs they send, like the game's clients.
+
+#define BOT_HISTORY 64         // Recent predicted positions kept to match relayed moves against
+#define BOT_TURN_MIN_MS 500    // Bots keep a direction for a random while
+#define BOT_TURN_MAX_MS 2000
+#define BOT_BIND_RETRY_MS 100
+#define BOT_MAX 4096           // Per process, each bot holds two sockets
+
+typedef struct BotSample {
+  Sint16 x, y;
+  Uint64 sent;
+} BotSample;
+
+typedef struct Bot {
+  NetConnection connection; // Must stay first, the message handler casts back
+  UDPsocket udp;
+  Player player;
+  Prediction prediction;
+  bool joined;
+  NetBinding binding;
+  Uint32 last_bind;
+  Uint8 input;
+  Uint32 next_turn;
+  Uint64 bytes_sent;
+  Uint64 bytes_received;
+  BotSample history[BOT_HISTORY];
+  int history_next;
+  NetFrame frames[NET_FRAME_HISTORY];
+  Uint32 acked_tick;
+  bool ack_pending;
+} Bot;
+
+static Bot *bots = NULL;
+static int bot_count = 0;
+static Bot *bot_by_slot[PLAYER_INDEX_MASK + 1]; // Which bot plays the server's player slot
+static UDPpacket *packet = NULL;
+static float bot_tick_seconds = 1.0f / TICK_RATE;
+
+static float *latencies = NULL; // Milliseconds from a bot's send to another bot's receive
+static int latency_count = 0;
+static int latency_capacity = 0;
+
+static void record_latency(float ms)
+{
+  if (latency_count == latency_capacity)
+  {
+    int capacity = latency_capacity ? latency_capacity * 2 : 4096;
+    float *grown = (float *)realloc(latencies, capacity * sizeof(float));
+    if (!grown)
+      return;
+    latencies = grown;
+    latency_capacity = capacity;
+  }
+  latencies[latency_count++] = ms;
+}
+
+// A snapshot entry is matched against the newest position its sender sent with those coordinates
+static void match_move(const NetPlayerState *state)
+{
+  Bot *sender = bot_by_slot[PLAYER_INDEX(state->id)];
+  if (!sender || sender->player.id != state->id)
+    return;
+  for (int j = 1; j <= BOT_HISTORY; j++)
+  {
+    const BotSample *sample = &sender->history[(sender->history_next - j + BOT_HISTORY) % BOT_HISTORY];
+    if (sample->sent && sample->x == state->x && sample->y == state->y)
+    {
+      record_latency((float)((SDL_GetPerformanceCounter() - sample->sent) * 1000.0 / SDL_GetPerformanceFrequency()));
+      return;
+    }
+  }
+}
+
+// Rebuilds the frame like the game does; only players the snapshot actually changed are timed
+static void receive_snapshot(Bot *bot, const NetSnapshot *snapshot)
+{
+  const NetFrame *baseline = net_frame_history_find(bot->frames, snapshot->baseline);
+  NetFrame *frame = &bot->frames[NET_FRAME_SLOT(snapshot->tick)];
+  if ((snapshot->baseline != NET_NO_BASELINE && !baseline) || frame == baseline)
+    return;
+  if (!net_snapshot_apply(baseline, snapshot, frame))
+  {
+    frame->tick = NET_NO_BASELINE;
+    return;
+  }
+
+  for (int i = 0; i < snapshot->count; i++)
+  {
+    const NetPlayerState *state = net_frame_find(frame, snapshot->entries[i].id);
+    if (state)
+      match_move(state);
+  }
+  for (int i = 0; i < snapshot->far_count; i++)
+    match_move(&snapshot->far[i]);
+  prediction_reconcile(&bot->prediction, &bot->player, snapshot->input_ack, snapshot->self_x, snapshot->self_y, bot_tick_seconds);
+
+  if (bot->acked_tick == NET_NO_BASELINE || (Sint32)(snapshot->tick - bot->acked_tick) > 0)
+  {
+    bot->acked_tick = snapshot->tick;
+    bot->ack_pending = true;
+  }
+}
+
+static void send_message(Bot *bot, NetMessageType type, NetMessage *message, bool unreliable)
+{
+  Uint8 buffer[NET_MAX_MESSAGE_SIZE];
+  int size = net_encode(type, message, buffer);
+  bool sent = unreliable
+                  ? net_connection_send_datagram(&bot->connection, bot->udp, buffer, size)
+                  : net_connection_send(&bot->connection, buffer, size);
+  if (sent)
+    bot->bytes_sent += size;
+}
+
+static bool handle_message(NetConnection *connection, const NetMessage *message)
+{
+  Bot *bot = (Bot *)connection;
+  switch (message->header.type)
+  {
+  case NET_MSG_ID:
+    bot->binding = message->data.binding;
+    bot->player.id = message->data.binding.id;
+    bot->joined = true;
+    bot_by_slot[PLAYER_INDEX(bot->player.id)] = bot;
+    break;
+  case NET_MSG_SNAPSHOT:
+    receive_snapshot(bot, &message->data.snapshot);
+    break;
+  case NET_MSG_PING:
+  {
+    // Answered like the game's network thread does, so the server's round trip stats cover bots
+    NetMessage pong;
+    pong.data.ping = message->data.ping;
+    send_message(bot, NET_MSG_PONG, &pong, bot->connection.udp_bound);
+    break;
+  }
+  default:
+    break;
+  }
+  return true;
+}
+
+// Announce the datagram address until the server's first datagram confirms it, like the game does
+static void send_bind(Bot *bot, Uint32 now)
+{
+  if (!bot->joined || bot->connection.udp_bound || now - bot->last_bind < BOT_BIND_RETRY_MS)
+    return;
+  bot->last_bind = now;
+
+  NetMessage message;
+  message.data.binding = bot->binding;
+  send_message(bot, NET_MSG_BIND, &message, true);
+}
+
+static void send_ack(Bot *bot)
+{
+  if (!bot->ack_pending)
+    return;
+  NetMessage message;
+  message.data.ack = bot->acked_tick;
+  send_message(bot, NET_MSG_ACK, &message, bot->connection.udp_bound);
+  bot->ack_pending = false;
+}
+
+static void move_bot(Bot *bot, Uint32 now, float dt)
+{
+  static const Uint8 directions[] = {
+      INPUT_UP, INPUT_DOWN, INPUT_LEFT, INPUT_RIGHT,
+      INPUT_UP | INPUT_LEFT, INPUT_UP | INPUT_RIGHT, INPUT_DOWN | INPUT_LEFT, INPUT_DOWN | INPUT_RIGHT};
+
+  if ((Sint32)(now - bot->next_turn) >= 0)
+  {
+    bot->input = directions[rand() % SDL_arraysize(directions)];
+    bot->next_turn = now + BOT_TURN_MIN_MS + rand() % (BOT_TURN_MAX_MS - BOT_TURN_MIN_MS);
+  }
+  if (prediction_apply(&bot->prediction, &bot->player, bot->input, dt))
+  {
+    NetPlayerState state;
+    net_player_state(&state, &bot->player);
+    BotSample *sample = &bot->history[bot->history_next];
+    sample->x = state.x;
+    sample->y = state.y;
+    sample->sent = SDL_GetPerformanceCounter();
+    bot->history_next = (bot->history_next + 1) % BOT_HISTORY;
+  }
+  else
+  {
+    bot->next_turn = now; // Walked into the edge of the map
+  }
+
+  NetMessage message;
+  if (prediction_pending(&bot->prediction, &message.data.input))
+    send_message(bot, NET_MSG_INPUT, &message, bot->connection.udp_bound);
+}
+
+static void receive(SDLNet_SocketSet socket_set)
+{
+  for (int i = 0; i < bot_count; i++)
+  {
+    Bot *bot = &bots[i];
+    if (!bot->connection.socket)
+      continue;
+
+    if (!bot->connection.closed && SDLNet_SocketReady(bot->connection.socket))
+    {
+      int received = net_connection_receive(&bot->connection, NULL);
+      if (received > 0)
+        bot->bytes_received += received;
+    }
+    net_connection_dispatch(&bot->connection, handle_message);
+
+    while ((SDLNet_SocketReady(bot->udp) || net_conditioner_enabled()) && net_conditioner_receive(bot->udp, packet) > 0)
+    {
+      bot->bytes_received += packet->len;
+      NetMessage message;
+      int offset = 0;
+      int used;
+      while (offset < packet->len && (used = net_decode_message(packet->data + offset, packet->len - offset, &message)) > 0)
+      {
+        offset += used;
+        if (net_connection_accept_datagram(&bot->connection, packet, &message.header))
+        {
+          bot->connection.udp_bound = true;
+          handle_message(&bot->connection, &message);
+        }
+      }
+    }
+
+    if (bot->connection.closed)
+    {
+      SDLNet_TCP_DelSocket(socket_set, bot->connection.socket);
+      SDLNet_UDP_DelSocket(socket_set, bot->udp);
+      net_connection_close(&bot->connection);
+      printf("Bot %d lost its connection\n", i);
+    }
+  }
+}
+
+static int compare_floats(const void *a, const void *b)
+{
+  float x = *(const float *)a, y = *(const float *)b;
+  return (x > y) - (x < y);
+}
+
+static float percentile(float p)
+{
+  if (latency_count == 0)
+    return 0.0f;
+  int index = (int)(p * (latency_count - 1) + 0.5f);
+  return latencies[index];
+}
+
+static void report(double seconds)
+{
+  int joined = 0;
+  Uint64 sent = 0, received = 0;
+  for (int i = 0; i < bot_count; i++)
+  {
+    if (bots[i].joined)
+      joined++;
+    sent += bots[i].bytes_sent;
+    received += bots[i].bytes_received;
+  }
+
+  printf("\n%d of %d bots joined, ran for %.1f s\n", joined, bot_count, seconds);
+  if (joined > 0 && seconds > 0.0)
+  {
+    printf("Per client: %.1f B/s up, %.1f B/s down\n",
+           sent / seconds / joined, received / seconds / joined);
+  }
+
+  if (latency_count > 0)
+    qsort(latencies, latency_count, sizeof(float), compare_floats);
+  printf("Move latency over %d samples: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+         latency_count, percentile(0.50f), percentile(0.95f), percentile(0.99f), percentile(1.0f));
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "Usage: loadtest [host] [--port <port>] [--bots <1-%d>] [--seconds <s>] [--tick-rate <%d-%d>]\n"
+                  "                [--latency <ms>] [--jitter <ms>] [--loss <%%>] [--duplicate <%%>] [--reorder <%%>]\n",
+          BOT_MAX, TICK_RATE_MIN, TICK_RATE_MAX);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *host = "127.0.0.1";
+  int port = 12345, count = MAX_PLAYERS - 1, seconds = 10, tick_rate = TICK_RATE;
+  NetConditions conditions = {0};
+  for (int i = 1; i < argc; i++)
+  {
+    if (net_conditions_parse(&conditions, argc, argv, &i))
+      continue;
+    if (strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+      port = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--bots") == 0 && i + 1 < argc)
+      count = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+      seconds = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+      tick_rate = atoi(argv[++i]);
+    else
+      host = argv[i];
+  }
+  if (count < 1 || seconds < 1 || tick_rate < 1)
+  {
+    usage();
+    return EXIT_FAILURE;
+  }
+  count = SDL_min(count, BOT_MAX);
+  tick_rate = SDL_clamp(tick_rate, TICK_RATE_MIN, TICK_RATE_MAX);
+
+  if (SDL_Init(SDL_INIT_TIMER) < 0 || SDLNet_Init() < 0)
+  {
+    fprintf(stderr, "SDL_Init Error: %s\n", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+  net_conditioner_configure(&conditions);
+
+  IPaddress ip;
+  if (SDLNet_ResolveHost(&ip, host, (Uint16)port) == -1)
+  {
+    fprintf(stderr, "SDLNet_ResolveHost: %s\n", SDLNet_GetError());
+    return EXIT_FAILURE;
+  }
+
+  bots = (Bot *)calloc(count, sizeof(Bot));
+  SDLNet_SocketSet socket_set = SDLNet_AllocSocketSet(count * 2);
+  packet = SDLNet_AllocPacket(NET_MAX_MESSAGE_SIZE);
+  if (!bots || !socket_set || !packet)
+  {
+    fprintf(stderr, "Failed to allocate %d bots\n", count);
+    return EXIT_FAILURE;
+  }
+
+  Uint32 now = SDL_GetTicks();
+  for (int i = 0; i < count; i++)
+  {
+    Bot *bot = &bots[i];
+    TCPsocket socket = SDLNet_TCP_Open(&ip);
+    bot->udp = SDLNet_UDP_Open(0);
+    if (!socket || !bot->udp)
+    {
+      fprintf(stderr, "Bot %d failed to connect: %s\n", i, SDLNet_GetError());
+      if (socket)
+        SDLNet_TCP_Close(socket);
+      break;
+    }
+    net_connection_init(&bot->connection, socket);
+    bot->connection.udp_address = ip; // The server listens for datagrams on the same port
+    simulation_init_player(&bot->player, -1);
+    prediction_init(&bot->prediction);
+    net_frame_history_clear(bot->frames);
+    bot->acked_tick = NET_NO_BASELINE;
+    bot->next_turn = now;
+    SDLNet_TCP_AddSocket(socket_set, socket);
+    SDLNet_UDP_AddSocket(socket_set, bot->udp);
+    bot_count++;
+  }
+  printf("Started %d bots against %s:%d\n", bot_count, host, port);
+
+  SimulationClock clock;
+  simulation_clock_init(&clock, tick_rate);
+  bot_tick_seconds = (float)clock.tick_seconds;
+  Uint64 start = SDL_GetPerformanceCounter();
+  double elapsed = 0.0;
+  while (elapsed < seconds)
+  {
+    if (SDLNet_CheckSockets(socket_set, 1) > 0 || net_conditioner_enabled())
+      receive(socket_set);
+    net_conditioner_flush();
+
+    int ticks = simulation_clock_advance(&clock);
+    now = SDL_GetTicks();
+    for (int t = 0; t < ticks; t++)
+    {
+      for (int i = 0; i < bot_count; i++)
+      {
+        if (bots[i].joined && !bots[i].connection.closed)
+        {
+          send_bind(&bots[i], now);
+          move_bot(&bots[i], now, (float)clock.tick_seconds);
+          send_ack(&bots[i]);
+          net_connection_flush(&bots[i].connection);
+        }
+      }
+    }
+    elapsed = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+  }
+
+  report(elapsed);
+
+  for (int i = 0; i < bot_count; i++)
+  {
+    net_connection_close(&bots[i].connection);
+    SDLNet_UDP_Close(bots[i].udp);
+  }
+  SDLNet_FreePacket(packet);
+  SDLNet_FreeSocketSet(socket_set);
+  free(bots);
+  free(latencies);
+  SDLNet_Quit();
+  SDL_Quit();
+  return EXIT_SUCCESS;
+}
@@ -10,8 +10,17 @@
 #include <assert.h>
 #include "../include/Game_Config.h"
 #include "../include/SDL_Ui.h"
-
-#define MAX_PLAYERS 4
+#include "../include/Terrain.h"
+#include "../include/Camera.h"
+#include "../include/Net_Protocol.h"
+#include "../include/Network.h"
+#include "../include/Simulation.h"
+#include "../include/Player_Table.h"
+#include "../include/Server.h"
+#include "../include/Net_Snapshot.h"
+#include "../include/Prediction.h"
+#include "../include/Interpolation.h"
+#include "../include/Net_Conditioner.h"
 
 SceneType current_scene = SCENE_MAIN_MENU;
 
@@ -19,18 +28,31 @@ SDL_Window *window = NULL;
 SDL_Renderer *renderer = NULL;
 SDL_Texture *FireZoneTexture = NULL;
 SDL_Texture *brickTexture = NULL;
+SDL_Texture *playerTexture = NULL;
 TTF_Font *font = NULL;
+Terrain *terrain = NULL;
+Camera camera;
 UILayout *layout = NULL;
 
-Player players[MAX_PLAYERS];
-int local_player_id = 0;
+PlayerTable players;
+int local_player_id = PLAYER_NONE;
+SimulationClock sim_clock;
+int tick_rate = TICK_RATE;
 
 // settings
-TCPsocket server_socket = NULL, client_socket = NULL;
-TCPsocket client_sockets[MAX_PLAYERS - 1] = {NULL};
-int num_clients = 0;
 bool is_server = false;
 bool is_connected = false;
+NetJoinState join_state = NET_JOIN_ASSIGN_ID; // Our own progress when joining as a client
+NetFrame snapshot_frames[NET_FRAME_HISTORY];   // Frames rebuilt from the server's snapshots
+Uint32 acked_tick = NET_NO_BASELINE;
+bool ack_pending = false;
+Prediction prediction; // Inputs applied locally that the server has yet to confirm
+Interpolation interpolation; // Where remote players are drawn, a little behind the snapshots
+int interpolation_delay_ms = INTERPOLATION_DELAY_MS;
+bool show_net_stats = false; // F3
+SDL_Texture *netStatsTexture = NULL;
+SDL_Rect netStatsRect = {8, 8, 0, 0};
+Uint32 net_stats_updated = 0;
 
 void ChangeToGameScene()
 {
@@ -51,16 +73,21 @@ bool loadTextures();
 bool initialize();
 void quit();
 void handleEvents(bool *running);
-void render();
+void render(float alpha);
 void renderFireZone();
 
-void handlePlayerMovement();
+void simulation_tick(float dt);
+void handlePlayerMovement(float dt);
+void send_ack();
 bool loadPlayer();
 void renderPlayer(Player *p);
 void renderTerrain();
+void renderNetStats();
 void start_server(int port);
 void start_client(const char *host, int port);
-void sync_player_position();
+void apply_remote_state(const NetPlayerState *state, Uint32 tick);
+void remove_remote_player(int id);
+void handle_client_message(const NetMessage *message);
 void process_network_data();
 
 int main(int argc, char *argv[])
@@ -71,18 +98,48 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
-  if (argc == 2 && strcmp(argv[1], "server") == 0)
+  // Usage: main [server | client <host>] [--tick-rate <hz>] [--interp-delay <ms>]
+  //             [--latency <ms>] [--jitter <ms>] [--loss <%>] [--duplicate <%>] [--reorder <%>]
+  const char *mode = NULL, *host = NULL;
+  NetConditions conditions = {0};
+  for (int i = 1; i < argc; i++)
+  {
+    if (net_conditions_parse(&conditions, argc, argv, &i))
+      continue;
+    if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+      tick_rate = SDL_clamp(atoi(argv[++i]), TICK_RATE_MIN, TICK_RATE_MAX);
+    else if (strcmp(argv[i], "--interp-delay") == 0 && i + 1 < argc)
+      interpolation_delay_ms = SDL_max(atoi(argv[++i]), 0);
+    else if (!mode)
+      mode = argv[i];
+    else if (!host)
+      host = argv[i];
+  }
+
+  net_conditioner_configure(&conditions);
+
+  // A client mirrors the server's IDs, which may index anywhere in the server's table
+  bool joining = mode && host && strcmp(mode, "client") == 0;
+  if (!player_table_init(&players, joining ? PLAYER_TABLE_MAX : MAX_PLAYERS))
+  {
+    fprintf(stderr, "Failed to allocate players!\n");
+    quit();
+    return EXIT_FAILURE;
+  }
+
+  if (mode && !host && strcmp(mode, "server") == 0)
   {
     start_server(12345);
   }
-  else if (argc == 3 && strcmp(argv[1], "client") == 0)
+  else if (joining)
   {
-    start_client(argv[2], 12345);
+    start_client(host, 12345);
   }
+  if (!player_table_get(&players, local_player_id))
+    local_player_id = player_table_add(&players)->id; // Playing on our own
 
   bool running = true;
-  const int FPS = 60;
-  const int frameDelay = 1000 / FPS;
+  const int frameDelay = 1000 / MAX_FRAME_RATE;
   Uint32 frameStart;
   int frameTime;
   // TODO: Taha Add more controls to font /bg buttons
@@ -102,6 +159,7 @@ int main(int argc, char *argv[])
   ui_layout_add_child(layout, (UIElement *)quitButton);
 
   ui_layout_arrange(layout);
+  camera_init(&camera, WINDOW_WIDTH, WINDOW_HEIGHT);
 
   if (!loadPlayer())
   {
@@ -111,19 +169,21 @@ int main(int argc, char *argv[])
   }
 
   assert(loadTextures());
+  simulation_clock_init(&sim_clock, tick_rate);
   while (running)
   {
     frameStart = SDL_GetTicks();
 
     handleEvents(&running);
+    int ticks = simulation_clock_advance(&sim_clock);
     if (current_scene == SCENE_GAMEPLAY)
     {
       process_network_data(); // Handle networking data (move player, sync positions, etc.)
-      sync_player_position(); // Sync player position over the network
-      handlePlayerMovement();
+      for (int i = 0; i < ticks; i++)
+        simulation_tick((float)sim_clock.tick_seconds);
     }
 
-    render();
+    render(simulation_clock_alpha(&sim_clock));
 
     frameTime = SDL_GetTicks() - frameStart;
     if (frameDelay > frameTime)
@@ -149,6 +209,12 @@ bool loadTextures() {
         printf("Failed to create texture from surface: %s\n", SDL_GetError());
         return false;
     }
+
+    terrain = terrain_create(renderer, brickTexture);
+    if (!terrain) {
+        printf("Failed to create terrain\n");
+        return false;
+    }
     return true;
 }
 
@@ -186,7 +252,7 @@ bool initialize()
     return false;
   }
 
-  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 
   if (renderer == NULL)
   {
@@ -230,6 +296,15 @@ bool initialize()
 
 void quit()
 {
+  if (is_server)
+    server_stop();
+  else
+    network_stop();
+  player_table_destroy(&players);
+  interpolation_destroy(&interpolation);
+  terrain_destroy(terrain);
+  SDL_DestroyTexture(playerTexture);
+  SDL_DestroyTexture(netStatsTexture);
   SDL_DestroyTexture(FireZoneTexture);
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
@@ -245,19 +320,23 @@ void handleEvents(bool *running)
   {
     if (event.type == SDL_QUIT)
       *running = false;
+    if ((event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) && terrain)
+      terrain_invalidate(terrain);
     switch (current_scene)
     {
     case SCENE_MAIN_MENU:
       ui_layout_handle_event((UIElement *)layout, &event);
       break;
     case SCENE_GAMEPLAY:
-      
+      if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3 && !event.key.repeat)
+        show_net_stats = !show_net_stats;
       break;
     }
   }
 }
 
-void render()
+// alpha is how far rendering is between the last two simulation ticks
+void render(float alpha)
 {
   switch (current_scene)
   {
@@ -271,15 +350,33 @@ void render()
   case SCENE_GAMEPLAY:
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
+    for (int i = 0; i < players.capacity; i++)
+    {
+      Player *p = &players.players[i];
+      float x, y;
+      if (p->id != local_player_id && interpolation_sample(&interpolation, p->id, alpha, &x, &y))
+      {
+        p->rect.x = (int)x;
+        p->rect.y = (int)y;
+        continue;
+      }
+      p->rect.x = (int)simulation_lerp(p->prev_x, p->x, alpha);
+      p->rect.y = (int)simulation_lerp(p->prev_y, p->y, alpha);
+    }
+    Player *local = player_table_get(&players, local_player_id);
+    if (local)
+      camera_follow(&camera, &local->rect);
     renderTerrain();
-    
-    for (int i = 0; i < MAX_PLAYERS; i++)
+
+    for (int i = 0; i < players.capacity; i++)
     {
-      if (players[i].active)
+      Player *p = &players.players[i];
+      if (p->active && camera_is_visible(&camera, &p->rect))
       {
-        renderPlayer(&players[i]);
+        renderPlayer(p);
       }
     }
+    renderNetStats();
     break;
   }
   SDL_RenderPresent(renderer);
@@ -300,275 +397,300 @@ bool loadPlayer()
     return false;
   }
 
-  for (int i = 0; i < MAX_PLAYERS; i++)
-  {
-    players[i].texture = SDL_CreateTextureFromSurface(renderer, playerSurface);
-    players[i].rect.w = 32;
-    players[i].rect.h = 32;
-    players[i].x = WINDOW_WIDTH / 2 - players[i].rect.w / 2;
-    players[i].y = WINDOW_HEIGHT / 2 - players[i].rect.h / 2;
-    players[i].rect.x = players[i].x;
-    players[i].rect.y = players[i].y;
-    players[i].active = false;
-  }
-  players[local_player_id].active = true;
+  // One texture shared by every player
+  playerTexture = SDL_CreateTextureFromSurface(renderer, playerSurface);
   SDL_FreeSurface(playerSurface);
 
-  return true;
+  return playerTexture != NULL;
 }
 
 void renderPlayer(Player *p)
 {
-  p->rect.x = p->x;
-  p->rect.y = p->y;
-  SDL_RenderCopy(renderer, p->texture, NULL, &p->rect);
+  SDL_Rect screenRect = camera_to_screen(&camera, &p->rect);
+  SDL_RenderCopy(renderer, playerTexture, NULL, &screenRect);
 }
 
-void handlePlayerMovement()
+// One fixed step of the game: movement and the network traffic it produces
+void simulation_tick(float dt)
 {
-  const Uint8 *state = SDL_GetKeyboardState(NULL);  
-    const int baseSpeed = 5;
-    int playerSpeed = baseSpeed;
-    const int mapPixelWidth = MAP_WIDTH * TILE_SIZE * 2;
-    const int mapPixelHeight = MAP_HEIGHT * TILE_SIZE * 2;
-    bool movedX = false, movedY = false;  
-
-    
-    if (state[SDL_SCANCODE_W] && players[local_player_id].y > 0) {
-        players[local_player_id].y -= playerSpeed;
-        movedY = true;
-    }
-
-    if (state[SDL_SCANCODE_S] && (players[local_player_id].y + players[local_player_id].rect.h) < mapPixelHeight) {
-        players[local_player_id].y += playerSpeed;
-        movedY = true;
-    }
+  simulation_begin_tick(players.players, players.capacity);
+  handlePlayerMovement(dt);
+  interpolation_advance(&interpolation, 1.0f);
+  send_ack();
+  if (is_server)
+    server_tick(dt); // Send this tick's snapshots
+}
 
-    if (state[SDL_SCANCODE_A] && players[local_player_id].x > 0) {
-        players[local_player_id].x -= playerSpeed;
-        movedX = true;
-    }
+void handlePlayerMovement(float dt)
+{
+  const Uint8 *state = SDL_GetKeyboardState(NULL);
+  Uint8 input = 0;
+  if (state[SDL_SCANCODE_W]) input |= INPUT_UP;
+  if (state[SDL_SCANCODE_S]) input |= INPUT_DOWN;
+  if (state[SDL_SCANCODE_A]) input |= INPUT_LEFT;
+  if (state[SDL_SCANCODE_D]) input |= INPUT_RIGHT;
+
+  Player *local = player_table_get(&players, local_player_id);
+  if (!local)
+    return;
+  if (!is_connected)
+  {
+    simulation_move_player(local, input, dt); // Hosting or offline, we are the authority
+    return;
+  }
 
-    if (state[SDL_SCANCODE_D] && (players[local_player_id].x + players[local_player_id].rect.w) < mapPixelWidth) {
-        players[local_player_id].x += playerSpeed;
-        movedX = true;
-    }
+  // Move right away and let the server catch up, every unconfirmed input is resent until it does
+  prediction_apply(&prediction, local, input, dt);
+  NetMessage message;
+  if (prediction_pending(&prediction, &message.data.input))
+  {
+    Uint8 buffer[NET_MAX_MESSAGE_SIZE];
+    int size = net_encode(NET_MSG_INPUT, &message, buffer);
+    if (size >= 0)
+      network_send(NET_SERVER_CONNECTION, NET_CHANNEL_UNRELIABLE, buffer, size);
+  }
+}
 
-     if (movedX && movedY) {
-        playerSpeed = baseSpeed / 1.414;  
-    }
+// Tell the server the newest snapshot we have, it becomes the baseline for the next ones
+void send_ack()
+{
+  if (!is_connected || !ack_pending)
+    return;
 
-    if ((movedX || movedY) && is_connected)
-    {
-        char buffer[256];
-        sprintf(buffer, "MOVE %d %d %d", local_player_id, players[local_player_id].x, players[local_player_id].y);
-        SDLNet_TCP_Send(client_socket, buffer, strlen(buffer) + 1);  // Send updated position to the server
-    }
+  NetMessage message;
+  Uint8 buffer[NET_MAX_MESSAGE_SIZE];
+  message.data.ack = acked_tick;
+  int size = net_encode(NET_MSG_ACK, &message, buffer);
+  if (size >= 0)
+    network_send(NET_SERVER_CONNECTION, NET_CHANNEL_UNRELIABLE, buffer, size);
+  ack_pending = false;
 }
 
-// Server to host the game
-void start_server(int port)
+// Connection overlay for clients. The text is only rebuilt when the network thread has
+// published new numbers, not every frame.
+void renderNetStats()
 {
-  IPaddress ip;
-  if (SDLNet_ResolveHost(&ip, NULL, port) == -1)
-  {
-    printf("SDLNet_ResolveHost: %s\n", SDLNet_GetError());
+  if (!show_net_stats || !is_connected || !font)
     return;
-  }
 
-  server_socket = SDLNet_TCP_Open(&ip);
-  if (!server_socket)
+  Uint32 now = SDL_GetTicks();
+  if (!netStatsTexture || now - net_stats_updated >= NET_STATS_INTERVAL_MS)
   {
-    printf("SDLNet_TCP_Open: %s\n", SDLNet_GetError());
-    return;
+    NetStats stats;
+    if (!network_get_stats(NET_SERVER_CONNECTION, &stats))
+      return;
+    net_stats_updated = now;
+
+    char text[192];
+    if (stats.rtt_ms >= 0.0f)
+      snprintf(text, sizeof(text), "RTT %.0f ms", stats.rtt_ms);
+    else
+      snprintf(text, sizeof(text), "RTT --");
+    size_t length = strlen(text);
+    snprintf(text + length, sizeof(text) - length, "  in %.1f kbit/s %.0f msg/s  out %.1f kbit/s %.0f msg/s  queued %d B  drops %u",
+             stats.kbps_in, stats.messages_in_rate, stats.kbps_out, stats.messages_out_rate, stats.send_queue, stats.drops);
+
+    SDL_Color color = {255, 255, 255, 255};
+    SDL_Surface *surface = TTF_RenderText_Blended(font, text, color);
+    if (!surface)
+      return;
+    SDL_DestroyTexture(netStatsTexture);
+    netStatsTexture = SDL_CreateTextureFromSurface(renderer, surface);
+    netStatsRect.w = surface->w / 2; // The UI font is large, the overlay is drawn at half size
+    netStatsRect.h = surface->h / 2;
+    SDL_FreeSurface(surface);
   }
 
-  printf("Server started on port %d\n", port);
-  is_server = true;
-  num_clients = 0; // No clients initially
+  SDL_Rect background = {netStatsRect.x - 4, netStatsRect.y - 2, netStatsRect.w + 8, netStatsRect.h + 4};
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+  SDL_RenderFillRect(renderer, &background);
+  SDL_RenderCopy(renderer, netStatsTexture, NULL, &netStatsRect);
+}
 
-  players[0].id = 0; // Server player is always ID 0
-  players[0].active = true;
+// Server to host the game
+void start_server(int port)
+{
+  // The host plays alongside the clients with the table's first player
+  Player *host = player_table_add(&players);
+  local_player_id = host->id;
+  is_server = server_start((Uint16)port, &players, MAX_PLAYERS - 1, tick_rate, host);
 }
 
 // Client to join a game
 void start_client(const char *host, int port)
 {
-  IPaddress ip;
-  if (SDLNet_ResolveHost(&ip, host, port) == -1)
-  {
-    printf("SDLNet_ResolveHost: %s\n", SDLNet_GetError());
+  if (!network_start_client(host, (Uint16)port))
     return;
-  }
-
-  client_socket = SDLNet_TCP_Open(&ip);
-  if (!client_socket)
-  {
-    printf("SDLNet_TCP_Open: %s\n", SDLNet_GetError());
-    return;
-  }
 
   printf("Connected to server at %s:%d\n", host, port);
   is_connected = true;
+  join_state = NET_JOIN_ASSIGN_ID;
+  net_frame_history_clear(snapshot_frames);
+  prediction_init(&prediction);
 
-  // Receive the assigned ID from the server
-  char buffer[256];
-  int len = SDLNet_TCP_Recv(client_socket, buffer, 256);
-  if (len > 0)
+  // Wait for the assigned ID, anything sent along with it is handled as well
+  Uint32 deadline = SDL_GetTicks() + NET_JOIN_TIMEOUT_MS;
+  while (is_connected && join_state == NET_JOIN_ASSIGN_ID)
   {
-    buffer[len] = '\0';
-    int assigned_id;
-    if (sscanf(buffer, "ID %d", &assigned_id) == 1)
+    if (SDL_TICKS_PASSED(SDL_GetTicks(), deadline))
     {
-      local_player_id = assigned_id;
-      players[local_player_id].active = true;
-      printf("Assigned ID: %d\n", local_player_id);
+      printf("Server did not assign an ID, playing on our own\n");
+      network_stop();
+      is_connected = false;
+      return;
     }
+    SDL_PumpEvents(); // Keeps the window responsive meanwhile
+    process_network_data();
+    SDL_Delay(1);
   }
+  if (!is_connected)
+  {
+    printf("Lost connection to server while joining\n");
+    return;
+  }
+
+  // Now that the server's tick rate is known, snapshots are timed in its ticks
+  float ticks_per_ms = tick_rate / 1000.0f;
+  if (!interpolation_init(&interpolation, players.capacity, interpolation_delay_ms * ticks_per_ms, INTERPOLATION_MAX_EXTRAPOLATION_MS * ticks_per_ms))
+    printf("Failed to allocate interpolation, remote players will not be smoothed\n");
 }
 
-// Sync player position between clients and server
-void sync_player_position()
+// Our own position is predicted and reconciled separately, everyone else's comes from the server
+void apply_remote_state(const NetPlayerState *state, Uint32 tick)
 {
-  if (is_server)
-  {
-    char buffer[256];
-    sprintf(buffer, "MOVE %d %d %d", players[local_player_id].id, players[local_player_id].x, players[local_player_id].y);
+  Player *p = state->id != local_player_id ? player_table_mirror(&players, state->id) : NULL;
+  if (!p)
+    return;
+  p->x = state->x;
+  p->y = state->y;
+  interpolation_push(&interpolation, state->id, tick, p->x, p->y);
+}
 
-    // Send updated position to all clients
-    for (int i = 0; i < num_clients; i++)
-    {
-      SDLNet_TCP_Send(client_sockets[i], buffer, strlen(buffer) + 1);
-    }
-    printf("Server broadcasted position: Player %d (%d, %d)\n", players[local_player_id].id, players[local_player_id].x, players[local_player_id].y);
-  }
+// A player that left the match, or our view of it; the far trickle brings back whoever is still there
+void remove_remote_player(int id)
+{
+  if (id == local_player_id)
+    return;
+  player_table_unmirror(&players, id);
+  interpolation_remove(&interpolation, id);
 }
 
-// Process network data
-void process_network_data()
+// Messages a client receives from the server
+void handle_client_message(const NetMessage *message)
 {
-  if (is_server)
+  if (message->header.type == NET_MSG_ID)
   {
-    TCPsocket client_socket = SDLNet_TCP_Accept(server_socket);
-    if (client_socket && num_clients < MAX_PLAYERS - 1)
+    if (player_table_mirror(&players, message->data.binding.id))
     {
-      client_sockets[num_clients] = client_socket;
-      players[num_clients + 1].id = num_clients + 1; // Assign client a unique ID
-      players[num_clients + 1].active = true;
-      num_clients++;
-
-      // Send the ID to the client
-      char buffer[256];
-      sprintf(buffer, "ID %d", players[num_clients].id);
-      SDLNet_TCP_Send(client_sockets[num_clients - 1], buffer, strlen(buffer) + 1);
-
-      // Send the new client the positions of all existing players (including host)
-      for (int i = 0; i < num_clients; i++)
-      {
-        if (players[i].active)
-        {
-          sprintf(buffer, "SYNC %d %d %d", players[i].id, players[i].x, players[i].y);
-          SDLNet_TCP_Send(client_sockets[num_clients - 1], buffer, strlen(buffer) + 1);
-          printf("Sent SYNC to new client: Player %d at position (%d, %d)\n", players[i].id, players[i].x, players[i].y);
-          _sleep(100);
-        }
-      }
-
-      // Notify all existing clients of the new player (broadcast new player to all)
-      sprintf(buffer, "SYNC %d %d %d", players[num_clients].id, players[num_clients].x, players[num_clients].y);
-      for (int i = 0; i < num_clients - 1; i++)
-      {
-        SDLNet_TCP_Send(client_sockets[i], buffer, strlen(buffer) + 1);
-      }
-
-      printf("Client %d connected with ID %d\n", num_clients, players[num_clients].id);
+      local_player_id = message->data.binding.id;
+      if (message->data.binding.tick_rate >= TICK_RATE_MIN && message->data.binding.tick_rate <= TICK_RATE_MAX)
+        tick_rate = message->data.binding.tick_rate; // Predictions only line up when we step like the server
+      join_state = NET_JOIN_SEND_WORLD;
+      printf("Assigned ID: %d\n", local_player_id);
     }
-
-    // Non-blocking check for client data
-    SDLNet_SocketSet socket_set = SDLNet_AllocSocketSet(num_clients);
-    for (int i = 0; i < num_clients; i++)
+    return;
+  }
+  if (message->header.type == NET_MSG_WORLD)
+  {
+    for (int i = 0; i < message->data.world.count; i++)
     {
-      SDLNet_TCP_AddSocket(socket_set, client_sockets[i]);
+      const NetPlayerState *state = &message->data.world.players[i];
+      Player *p = player_table_mirror(&players, state->id);
+      if (!p)
+        continue;
+      p->x = p->prev_x = state->x;
+      p->y = p->prev_y = state->y;
     }
-    int num_ready_sockets = SDLNet_CheckSockets(socket_set, 0); // Non-blocking check
-    if (num_ready_sockets > 0)
+    join_state = NET_JOIN_ACTIVE;
+    printf("Received world state with %d players\n", message->data.world.count);
+    return;
+  }
+  if (message->header.type == NET_MSG_SNAPSHOT)
+  {
+    // Snapshots against a frame we no longer have (or never got) are dropped, the server
+    // falls back to its newest frame we acknowledged
+    const NetSnapshot *snapshot = &message->data.snapshot;
+    const NetFrame *baseline = net_frame_history_find(snapshot_frames, snapshot->baseline);
+    if (snapshot->baseline != NET_NO_BASELINE && !baseline)
+      return;
+    NetFrame *frame = &snapshot_frames[NET_FRAME_SLOT(snapshot->tick)];
+    if (frame == baseline)
+      return;
+    if (!net_snapshot_apply(baseline, snapshot, frame))
     {
-      for (int i = 0; i < num_clients; i++)
-      {
-        if (SDLNet_SocketReady(client_sockets[i]))
-        {
-          char buffer[256];
-          int len = SDLNet_TCP_Recv(client_sockets[i], buffer, 256);
-          if (len > 0)
-          {
-            buffer[len] = '\0';
-            int id, x, y;
-            if (sscanf(buffer, "MOVE %d %d %d", &id, &x, &y) == 3)
-            {
-              players[id].x = x;
-              players[id].y = y;
-              printf("Received from client %d: Player %d moved to (%d, %d)\n", i, id, x, y);
-              // Broadcast this movement to all clients
-              for (int j = 0; j < num_clients; j++)
-              {
-                if (j != i)
-                { // Don't send it back to the client that sent it
-                  SDLNet_TCP_Send(client_sockets[j], buffer, strlen(buffer) + 1);
-                }
-              }
-            }
-          }
-        }
-      }
+      frame->tick = NET_NO_BASELINE;
+      return;
     }
-    SDLNet_FreeSocketSet(socket_set);
+
+    interpolation_receive(&interpolation, snapshot->tick);
+    // Whoever dropped out of the frame is gone until the far list mentions them again
+    for (int i = 0; baseline && i < baseline->count; i++)
+      if (!net_frame_find(frame, baseline->players[i].id))
+        remove_remote_player(baseline->players[i].id);
+    for (int i = 0; i < frame->count; i++)
+      apply_remote_state(&frame->players[i], snapshot->tick);
+    for (int i = 0; i < snapshot->far_count; i++)
+      apply_remote_state(&snapshot->far[i], snapshot->tick);
+    Player *local = player_table_get(&players, local_player_id);
+    if (local)
+      prediction_reconcile(&prediction, local, snapshot->input_ack, snapshot->self_x, snapshot->self_y, (float)sim_clock.tick_seconds);
+
+    if (acked_tick == NET_NO_BASELINE || (Sint32)(snapshot->tick - acked_tick) > 0)
+    {
+      acked_tick = snapshot->tick;
+      ack_pending = true;
+    }
+    return;
+  }
+  if (message->header.type == NET_MSG_LEAVE)
+  {
+    remove_remote_player(message->data.leave);
+    printf("Player %d left\n", message->data.leave);
+    return;
   }
-  else if (is_connected)
+  if (message->header.type != NET_MSG_SYNC)
+    return;
+
+  int id = message->data.player.id;
+  Player *p = player_table_mirror(&players, id);
+  if (!p)
+    return;
+  p->x = message->data.player.x;
+  p->y = message->data.player.y;
+  printf("Synced player %d to position (%d, %d)\n", id, message->data.player.x, message->data.player.y);
+}
+
+// Process network data handed over by the network thread
+void process_network_data()
+{
+  if (is_server)
   {
-    // Non-blocking check for server data
-    SDLNet_SocketSet socket_set = SDLNet_AllocSocketSet(1);
-    SDLNet_TCP_AddSocket(socket_set, client_socket);
+    server_update();
+    return;
+  }
+  if (!is_connected)
+    return;
 
-    int num_ready_sockets = SDLNet_CheckSockets(socket_set, 0); // Non-blocking check
-    if (num_ready_sockets > 0)
+  const NetEvent *event;
+  while ((event = network_peek_event()) != NULL)
+  {
+    switch (event->type)
     {
-      if (SDLNet_SocketReady(client_socket))
-      {
-        char buffer[256];
-        int len = SDLNet_TCP_Recv(client_socket, buffer, 256);
-        if (len > 0)
-        {
-          buffer[len] = '\0';
-          int id, x, y;
-          if (sscanf(buffer, "MOVE %d %d %d", &id, &x, &y) == 3)
-          {
-            players[id].x = x;
-            players[id].y = y;
-          }
-          else if (sscanf(buffer, "SYNC %d %d %d", &id, &x, &y) == 3)
-          {
-            players[id].x = x;
-            players[id].y = y;
-            players[id].active = true; // Activate the player
-            printf("Synced player %d to position (%d, %d)\n", id, x, y);
-          }
-        }
-      }
+    case NET_EVENT_CONNECTED:
+      break;
+    case NET_EVENT_DISCONNECTED:
+      printf("Disconnected from server\n");
+      is_connected = false;
+      break;
+    case NET_EVENT_MESSAGE:
+      handle_client_message(&event->message);
+      break;
     }
-    SDLNet_FreeSocketSet(socket_set);
+    network_pop_event();
   }
 }
 
 void renderTerrain() {
-    SDL_Rect tileRect = {0, 0, TILE_SIZE * 2, TILE_SIZE * 2};
-    
-
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
-          SDL_SetTextureColorMod(brickTexture,255,x*y,x-y);
-            tileRect.x = x * TILE_SIZE * 2;
-            tileRect.y = y * TILE_SIZE * 2;
-            SDL_RenderCopy(renderer, brickTexture, NULL, &tileRect);
-        }
-    }
-}
\ No newline at end of file
+    terrain_draw(terrain, renderer, &camera.view);
+}
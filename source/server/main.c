@@ -0,0 +1,163 @@
+#include "../../SDL2/include/SDL.h"
+#include "../../SDL2/include/SDL_net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include "../../include/Game_Config.h"
+#include "../../include/Simulation.h"
+#include "../../include/Player_Table.h"
+#include "../../include/Server.h"
+#include "../../include/Server_Pool.h"
+#include "../../include/Net_Conditioner.h"
+
+// Headless dedicated server: no window, renderer, textures, fonts or audio, only the
+// network thread and the fixed-tick simulation. With --rooms it hosts that many independent
+// matches behind the same port, ticked by a pool of worker threads (see Server_Pool.h).
+
+#define REPORT_SECONDS 5 // How often tick times and network statistics are printed
+
+static volatile sig_atomic_t running = 1;
+
+PlayerTable players;
+
+static void stop(int sig)
+{
+  (void)sig;
+  running = 0;
+}
+
+// The main thread only reports while the workers run the rooms
+static void run_rooms(void)
+{
+  Uint32 last_report = SDL_GetTicks();
+  while (running)
+  {
+    SDL_Delay(100);
+    if (SDL_GetTicks() - last_report < REPORT_SECONDS * 1000)
+      continue;
+    last_report = SDL_GetTicks();
+    for (int w = 0; w < server_pool_workers(); w++)
+    {
+      ServerWorkerReport report;
+      server_pool_take_report(w, &report);
+      if (report.work_count == 0)
+        continue;
+      printf("Worker %d: %d rooms, %d players, tick time avg %.3f ms, max %.3f ms over %d ticks, %d overruns\n",
+             w, report.rooms, report.players, report.work_total * 1000.0 / report.work_count,
+             report.work_max * 1000.0, report.ticks, report.overruns);
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  // Usage: server [port] [--tick-rate <hz>] [--max-players <n>] [--rooms <n>] [--workers <n>]
+  //               [--latency <ms>] [--jitter <ms>] [--loss <%>] [--duplicate <%>] [--reorder <%>]
+  int port = 12345;
+  int tick_rate = TICK_RATE;
+  int max_players = MAX_PLAYERS; // Per room
+  int rooms = 1;
+  int workers = 0; // One per core by default
+  NetConditions conditions = {0};
+  for (int i = 1; i < argc; i++)
+  {
+    if (net_conditions_parse(&conditions, argc, argv, &i))
+      continue;
+    if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+      tick_rate = SDL_clamp(atoi(argv[++i]), TICK_RATE_MIN, TICK_RATE_MAX);
+    else if (strcmp(argv[i], "--max-players") == 0 && i + 1 < argc)
+      max_players = SDL_clamp(atoi(argv[++i]), 1, PLAYER_TABLE_MAX);
+    else if (strcmp(argv[i], "--rooms") == 0 && i + 1 < argc)
+      rooms = SDL_clamp(atoi(argv[++i]), 1, SERVER_POOL_MAX_ROOMS);
+    else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+      workers = atoi(argv[++i]);
+    else
+      port = atoi(argv[i]);
+  }
+
+  if (SDL_Init(SDL_INIT_TIMER) < 0 || SDLNet_Init() < 0)
+  {
+    fprintf(stderr, "SDL_Init Error: %s\n", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+  net_conditioner_configure(&conditions);
+
+  if (rooms > 1)
+  {
+    if (!server_pool_start((Uint16)port, rooms, max_players, workers > 0 ? workers : SDL_GetCPUCount(), tick_rate))
+    {
+      SDLNet_Quit();
+      SDL_Quit();
+      return EXIT_FAILURE;
+    }
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    run_rooms();
+    printf("Shutting down\n");
+    server_pool_stop();
+    SDLNet_Quit();
+    SDL_Quit();
+    return EXIT_SUCCESS;
+  }
+
+  if (!player_table_init(&players, max_players) || !server_start((Uint16)port, &players, max_players, tick_rate, NULL))
+  {
+    player_table_destroy(&players);
+    SDLNet_Quit();
+    SDL_Quit();
+    return EXIT_FAILURE;
+  }
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  SimulationClock clock;
+  simulation_clock_init(&clock, tick_rate);
+  double frequency = (double)SDL_GetPerformanceFrequency();
+  double work_total = 0.0, work_max = 0.0; // Seconds spent updating, per loop that ran ticks
+  int work_count = 0;
+  Uint64 last_report = SDL_GetPerformanceCounter();
+  while (running)
+  {
+    int ticks = simulation_clock_advance(&clock);
+    Uint64 work_start = SDL_GetPerformanceCounter();
+    server_update();
+    for (int i = 0; i < ticks; i++)
+    {
+      simulation_begin_tick(players.players, players.capacity);
+      server_tick((float)clock.tick_seconds);
+    }
+    Uint64 work_end = SDL_GetPerformanceCounter();
+
+    if (ticks > 0)
+    {
+      double work = (work_end - work_start) / frequency;
+      work_total += work;
+      work_max = SDL_max(work_max, work);
+      work_count++;
+    }
+    if ((work_end - last_report) / frequency >= REPORT_SECONDS && work_count > 0)
+    {
+      printf("Tick time: avg %.3f ms, max %.3f ms over %d ticks\n",
+             work_total * 1000.0 / work_count, work_max * 1000.0, work_count);
+      server_print_stats();
+      work_total = work_max = 0.0;
+      work_count = 0;
+      last_report = work_end;
+    }
+
+    // Sleep for what is left of the tick instead of spinning
+    double remaining = clock.tick_seconds - clock.accumulator;
+    if (remaining > 0.001)
+      SDL_Delay((Uint32)(remaining * 1000.0));
+  }
+
+  printf("Shutting down\n");
+  server_stop();
+  player_table_destroy(&players);
+  SDLNet_Quit();
+  SDL_Quit();
+  return EXIT_SUCCESS;
+}